@@ -6,7 +6,9 @@
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/ktrace.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -93,6 +95,9 @@ static void wait_until_idle (const struct disk *);
 static bool wait_while_busy (const struct disk *);
 static void select_device (const struct disk *);
 static void select_device_wait (const struct disk *);
+#ifdef KTRACE
+static unsigned disk_trace_id (const struct disk *, bool write);
+#endif
 
 static void interrupt_handler (struct intr_frame *);
 
@@ -210,11 +215,14 @@ disk_size (struct disk *d) {
 void
 disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
 	struct channel *c;
+	enum cpu_acct prev_acct;
 
 	ASSERT (d != NULL);
 	ASSERT (buffer != NULL);
 
 	c = d->channel;
+	prev_acct = thread_acct_enter (ACCT_IOWAIT);
+	KTRACE_EVENT (KT_DISK, sec_no, disk_trace_id (d, false));
 	lock_acquire (&c->lock);
 	select_sector (d, sec_no);
 	issue_pio_command (c, CMD_READ_SECTOR_RETRY);
@@ -224,6 +232,8 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
 	input_sector (c, buffer);
 	d->read_cnt++;
 	lock_release (&c->lock);
+	KTRACE_EVENT (KT_DISK_DONE, sec_no, disk_trace_id (d, false));
+	thread_acct_enter (prev_acct);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -234,11 +244,14 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
 void
 disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
 	struct channel *c;
+	enum cpu_acct prev_acct;
 
 	ASSERT (d != NULL);
 	ASSERT (buffer != NULL);
 
 	c = d->channel;
+	prev_acct = thread_acct_enter (ACCT_IOWAIT);
+	KTRACE_EVENT (KT_DISK, sec_no, disk_trace_id (d, true));
 	lock_acquire (&c->lock);
 	select_sector (d, sec_no);
 	issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
@@ -248,6 +261,8 @@ disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
 	sema_down (&c->completion_wait);
 	d->write_cnt++;
 	lock_release (&c->lock);
+	KTRACE_EVENT (KT_DISK_DONE, sec_no, disk_trace_id (d, true));
+	thread_acct_enter (prev_acct);
 }
 
 /* Disk detection and identification. */
@@ -401,6 +416,15 @@ print_ata_string (char *string, size_t size) {
 		printf ("%c", string[i ^ 1]);
 }
 
+#ifdef KTRACE
+/* Identifies an access to D for the event trace: hdCHAN:DEV as
+   CHAN * 2 + DEV, shifted left once, with WRITE in bit 0. */
+static unsigned
+disk_trace_id (const struct disk *d, bool write) {
+	return ((d->channel - channels) * 2 + d->dev_no) << 1 | write;
+}
+#endif
+
 /* Selects device D, waiting for it to become ready, and then
    writes SEC_NO to the disk's sector selection registers.  (We
    use LBA mode.) */
@@ -0,0 +1,207 @@
+#include "devices/hrtimer.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <list.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/io.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+/* High-resolution sleeps.
+
+   Time is kept by the TSC, whose rate is measured against the 8254
+   tick in hrtimer_calibrate().  A sleep first blocks on the ordinary
+   tick wheel until less than two ticks are left, then parks on a
+   deadline-ordered queue.  While that queue is non-empty the CMOS RTC
+   raises its periodic interrupt at RTC_HZ, and each interrupt wakes
+   every sleeper whose TSC deadline has passed, so a wakeup is late by
+   at most one RTC period instead of a whole tick.
+
+   The RTC is used as the fine-grained event source, rather than the
+   local APIC timer, because it sits behind the PIC this kernel already
+   drives and leaves the 8254's tick phase untouched. */
+
+/* CMOS RTC ports and registers.  Setting bit 7 of the index keeps
+   NMIs masked while we talk to the chip. */
+#define CMOS_INDEX 0x70
+#define CMOS_DATA 0x71
+#define RTC_REG_A 0x8a          /* Rate select in bits 0...3. */
+#define RTC_REG_B 0x8b          /* Bit 6 enables the periodic interrupt. */
+#define RTC_REG_C 0x0c          /* Reading acknowledges the interrupt. */
+#define RTC_PIE 0x40
+#define RTC_RATE 3              /* 32768 >> (RATE - 1) = 8192 Hz. */
+#define RTC_HZ (32768 >> (RTC_RATE - 1))
+#define RTC_IRQ 0x28
+
+/* A thread in the fine phase of hrtimer_sleep(). */
+struct hr_sleeper {
+	uint64_t deadline;          /* TSC value to wake at. */
+	struct thread *thread;
+	struct list_elem elem;
+};
+
+static struct list sleepers;    /* Ordered by deadline. */
+static uint64_t tsc_hz;         /* 0 until calibrated. */
+static uint64_t tsc_base;       /* TSC at calibration; hrtimer_now() is 0 there. */
+static uint64_t ns_to_tsc_mult; /* TSC cycles per ns, << 24. */
+static uint64_t tsc_to_ns_mult; /* ns per TSC cycle, << 32. */
+
+static intr_handler_func rtc_interrupt;
+static void rtc_set_periodic (bool on);
+static uint64_t ns_to_tsc (uint64_t ns);
+static bool deadline_less (const struct list_elem *, const struct list_elem *,
+		void *aux);
+
+/* Registers the RTC interrupt.  The RTC stays quiet until a thread
+   needs it. */
+void
+hrtimer_init (void) {
+	list_init (&sleepers);
+	rtc_set_periodic (false);
+	intr_register_ext (RTC_IRQ, rtc_interrupt, "RTC");
+}
+
+/* Measures the TSC rate over TIMER_FREQ / 10 timer ticks.  Must run
+   with interrupts on, after timer_calibrate(). */
+void
+hrtimer_calibrate (void) {
+	const int span = TIMER_FREQ / 10;
+	int64_t start;
+	uint64_t tsc0, tsc1;
+
+	ASSERT (intr_get_level () == INTR_ON);
+	printf ("Calibrating TSC...  ");
+
+	/* Start on a tick edge. */
+	start = timer_ticks ();
+	while (timer_ticks () == start)
+		barrier ();
+	start = timer_ticks ();
+	tsc0 = rdtsc ();
+	while (timer_ticks () < start + span)
+		barrier ();
+	tsc1 = rdtsc ();
+
+	tsc_base = tsc1;
+	tsc_hz = (tsc1 - tsc0) * TIMER_FREQ / span;
+	ns_to_tsc_mult = (tsc_hz << 24) / NSEC_PER_SEC;
+	tsc_to_ns_mult = ((uint64_t) NSEC_PER_SEC << 32) / tsc_hz;
+	printf ("%'"PRIu64" Hz.\n", tsc_hz);
+}
+
+/* Returns true once hrtimer_calibrate() has run. */
+bool
+hrtimer_ready (void) {
+	return tsc_hz != 0;
+}
+
+/* Returns the measured TSC rate, or 0 before calibration. */
+uint64_t
+hrtimer_tsc_hz (void) {
+	return tsc_hz;
+}
+
+/* Returns nanoseconds elapsed since calibration. */
+uint64_t
+hrtimer_now (void) {
+	ASSERT (hrtimer_ready ());
+	return hrtimer_cycles_to_ns (rdtsc () - tsc_base);
+}
+
+/* Converts a span of CYCLES TSC cycles to nanoseconds.  Returns 0
+   before calibration. */
+uint64_t
+hrtimer_cycles_to_ns (uint64_t cycles) {
+	return ((unsigned __int128) cycles * tsc_to_ns_mult) >> 32;
+}
+
+/* Blocks the running thread for NS nanoseconds. */
+void
+hrtimer_sleep (int64_t ns) {
+	struct hr_sleeper self;
+	enum intr_level old_level;
+	int64_t coarse;
+
+	ASSERT (hrtimer_ready ());
+	ASSERT (intr_get_level () == INTR_ON);
+	if (ns <= 0)
+		return;
+
+	self.deadline = rdtsc () + ns_to_tsc (ns);
+	self.thread = thread_current ();
+
+	/* Cover whole ticks with the tick wheel, leaving at least one
+	   full tick for the fine phase. */
+	coarse = ns / (NSEC_PER_SEC / TIMER_FREQ) - 1;
+	if (coarse > 0)
+		timer_sleep (coarse);
+
+	old_level = intr_disable ();
+	if (rdtsc () < self.deadline) {
+		if (list_empty (&sleepers))
+			rtc_set_periodic (true);
+		list_insert_ordered (&sleepers, &self.elem, deadline_less, NULL);
+		thread_block ();
+	}
+	intr_set_level (old_level);
+}
+
+/* RTC periodic interrupt: wakes every sleeper that is due. */
+static void
+rtc_interrupt (struct intr_frame *args UNUSED) {
+	outb (CMOS_INDEX, RTC_REG_C);
+	inb (CMOS_DATA);
+
+	uint64_t now = rdtsc ();
+	while (!list_empty (&sleepers)) {
+		struct hr_sleeper *s = list_entry (list_front (&sleepers),
+				struct hr_sleeper, elem);
+		if (s->deadline > now)
+			break;
+		list_pop_front (&sleepers);
+		thread_unblock (s->thread);
+	}
+	if (list_empty (&sleepers))
+		rtc_set_periodic (false);
+	/* A woken sleeper may outrank the interrupted thread. */
+	check_preemption ();
+}
+
+/* Turns the RTC periodic interrupt on or off. */
+static void
+rtc_set_periodic (bool on) {
+	enum intr_level old_level = intr_disable ();
+	uint8_t b;
+
+	if (on) {
+		outb (CMOS_INDEX, RTC_REG_A);
+		uint8_t a = inb (CMOS_DATA);
+		outb (CMOS_INDEX, RTC_REG_A);
+		outb (CMOS_DATA, (a & 0xf0) | RTC_RATE);
+	}
+	outb (CMOS_INDEX, RTC_REG_B);
+	b = inb (CMOS_DATA);
+	outb (CMOS_INDEX, RTC_REG_B);
+	outb (CMOS_DATA, on ? b | RTC_PIE : b & ~RTC_PIE);
+
+	/* Drop any interrupt already latched. */
+	outb (CMOS_INDEX, RTC_REG_C);
+	inb (CMOS_DATA);
+	intr_set_level (old_level);
+}
+
+static uint64_t
+ns_to_tsc (uint64_t ns) {
+	return ((unsigned __int128) ns * ns_to_tsc_mult) >> 24;
+}
+
+static bool
+deadline_less (const struct list_elem *a_, const struct list_elem *b_,
+		void *aux UNUSED) {
+	const struct hr_sleeper *a = list_entry (a_, struct hr_sleeper, elem);
+	const struct hr_sleeper *b = list_entry (b_, struct hr_sleeper, elem);
+	return a->deadline < b->deadline;
+}
@@ -3,6 +3,7 @@
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
+#include "devices/hrtimer.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/synch.h"
@@ -20,11 +21,50 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* 8254 input clock, and input clocks per timer tick. */
+#define PIT_HZ 1193180
+static uint16_t pit_count;
+
+/* Dynamic ticks.  If true ("-tickless"), the idle thread replaces
+   the periodic interrupt by a single one-shot that lands on the next
+   tick something is due, and the skipped ticks are replayed when it
+   fires (or when another interrupt wakes the CPU first). */
+bool timer_tickless;
+static int oneshot_ticks;       /* Ticks covered by the armed one-shot, or 0. */
+static uint16_t oneshot_count;  /* Input clocks it was armed with. */
+static int64_t suppressed_ticks; /* Ticks that passed without an interrupt. */
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Hierarchical timing wheel.  Level L has WHEEL_SLOTS slots, each
+   covering 2^(L*WHEEL_BITS) ticks, so together the levels reach
+   2^(WHEEL_LEVELS*WHEEL_BITS) ticks ahead; later deadlines are parked
+   in the farthest slot and re-filed when it cascades.  Arming is O(1);
+   each timer is cascaded at most WHEEL_LEVELS - 1 times before it
+   fires, so expiry is amortized O(1) and an ordinary tick only looks
+   at one level-0 slot. */
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_SPAN(LEVEL) (1LL << ((LEVEL) * WHEEL_BITS))
+
+static struct list wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+static int64_t wheel_now;       /* Next tick the wheel will process. */
+
 static intr_handler_func timer_interrupt;
+static void wheel_add (struct timer *);
+static void wheel_cascade (int level);
+static void wheel_run (void);
+static void wake_sleeper (struct timer *, void *thread);
+static int64_t wheel_next_deadline (int limit);
+static void pit_periodic (void);
+static void pit_oneshot (uint16_t count);
+static uint16_t pit_read (void);
+static bool pit_read_back (uint16_t *count);
+static void advance_ticks (int n);
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
@@ -36,11 +76,15 @@ void
 timer_init (void) {
 	/* 8254 input frequency divided by TIMER_FREQ, rounded to
 	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+	pit_count = (PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ;
 
-	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb (0x40, count & 0xff);
-	outb (0x40, count >> 8);
+	for (int level = 0; level < WHEEL_LEVELS; level++)
+		for (int slot = 0; slot < WHEEL_SLOTS; slot++)
+			list_init (&wheel[level][slot]);
+	wheel_now = 0;
+
+	oneshot_ticks = 0;
+	pit_periodic ();
 
 	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
@@ -80,6 +124,13 @@ timer_ticks (void) {
 	return t;
 }
 
+/* Returns the tick count; interrupts must already be off. */
+static inline int64_t
+ticks_now_locked (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	return ticks;
+}
+
 /* Returns the number of timer ticks elapsed since THEN, which
    should be a value once returned by timer_ticks(). */
 int64_t
@@ -90,11 +141,57 @@ timer_elapsed (int64_t then) {
 /* Suspends execution for approximately TICKS timer ticks. */
 void
 timer_sleep (int64_t ticks) {
-	int64_t wakeup = timer_ticks () + ticks;
-	// ASSERT (intr_get_level () == INTR_ON); /* 🔥 Verify that the timer interrupt is working */
-	struct thread *current_thread = thread_current ();
-	current_thread->wakeup_tick = wakeup; /* 🔥 Set wakeup tick */
-	thread_sleep (); /* 🔥 Discard control while waiting */
+	struct timer timer;
+	enum intr_level old_level;
+
+	ASSERT (intr_get_level () == INTR_ON);
+	if (ticks <= 0)
+		return;
+
+	timer_setup (&timer, wake_sleeper, thread_current ());
+	old_level = intr_disable ();
+	timer_arm (&timer, ticks + ticks_now_locked ());
+	thread_block ();
+	intr_set_level (old_level);
+}
+
+/* Prepares TIMER to call FUNC with AUX.  The timer is not armed. */
+void
+timer_setup (struct timer *timer, timer_func *func, void *aux) {
+	ASSERT (timer != NULL && func != NULL);
+	timer->expires = 0;
+	timer->func = func;
+	timer->aux = aux;
+	timer->pending = false;
+}
+
+/* Arms TIMER to fire at absolute tick EXPIRES, re-arming it if it
+   was already pending.  A deadline in the past fires on the next
+   tick.  May be called from interrupt context. */
+void
+timer_arm (struct timer *timer, int64_t expires) {
+	enum intr_level old_level = intr_disable ();
+	if (timer->pending)
+		list_remove (&timer->elem);
+	timer->expires = expires;
+	timer->pending = true;
+	wheel_add (timer);
+	intr_set_level (old_level);
+}
+
+/* Disarms TIMER.  Returns true if it was pending, false if it had
+   already fired (or was never armed).  Once this returns, FUNC is
+   not running and will not be called for this arming. */
+bool
+timer_cancel (struct timer *timer) {
+	enum intr_level old_level = intr_disable ();
+	bool was_pending = timer->pending;
+	if (was_pending) {
+		list_remove (&timer->elem);
+		timer->pending = false;
+	}
+	intr_set_level (old_level);
+	return was_pending;
 }
 
 /* Suspends execution for approximately MS milliseconds. */
@@ -115,18 +212,223 @@ timer_nsleep (int64_t ns) {
 	real_time_sleep (ns, 1000 * 1000 * 1000);
 }
 
+/* Called by the idle thread, with interrupts off, right before it
+   halts.  In tickless mode, stops the periodic tick until the next
+   tick at which a timer is due, as far as the 16-bit PIT reaches:
+   UINT16_MAX / pit_count ticks, which at TIMER_FREQ 100 is only 5
+   (about 55 ms), so a long idle stretch still takes an interrupt
+   every 5 ticks instead of 1. */
+void
+timer_idle_enter (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (!timer_tickless || oneshot_ticks != 0)
+		return;
+
+	int limit = UINT16_MAX / pit_count;
+	int skip = wheel_next_deadline (limit) - ticks;
+	if (skip < 2)
+		return;
+
+	/* Part of the current tick has already gone by. */
+	uint16_t elapsed = pit_count - pit_read ();
+	oneshot_ticks = skip;
+	oneshot_count = skip * pit_count - elapsed;
+	pit_oneshot (oneshot_count);
+}
+
+/* Leaves tickless idle early because some other interrupt arrived.
+   Catches the tick count up to now and arms a one-shot for the rest
+   of the current tick, after which timer_interrupt() goes back to
+   the periodic mode.  Interrupts must be off. */
+void
+timer_idle_exit (void) {
+	uint16_t remaining;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (oneshot_ticks == 0)
+		return;
+	/* Already expired: the pending timer interrupt catches up. */
+	if (pit_read_back (&remaining))
+		return;
+
+	unsigned elapsed = oneshot_count - remaining;
+	suppressed_ticks += elapsed / pit_count;
+	advance_ticks (elapsed / pit_count);
+	wheel_run ();
+
+	oneshot_ticks = 1;
+	oneshot_count = pit_count - elapsed % pit_count;
+	pit_oneshot (oneshot_count);
+}
+
+/* Returns the number of ticks that went by without a timer
+   interrupt of their own because the idle thread was tickless. */
+int64_t
+timer_suppressed_ticks (void) {
+	enum intr_level old_level = intr_disable ();
+	int64_t t = suppressed_ticks;
+	intr_set_level (old_level);
+	return t;
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void) {
 	printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+	if (timer_tickless)
+		printf ("Tickless: %"PRId64" tick interrupts suppressed\n",
+				timer_suppressed_ticks ());
 }
 
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED) {
-	ticks++;
-	thread_tick ();
-	thread_wake_up (ticks); /* 🔥 Modified */
+	int n = 1;
+
+	if (oneshot_ticks != 0) {
+		n = oneshot_ticks;
+		oneshot_ticks = 0;
+		suppressed_ticks += n - 1;
+		pit_periodic ();
+	}
+	advance_ticks (n);
+	wheel_run ();
+}
+
+/* Accounts N elapsed ticks, one thread_tick() each, so that the
+   scheduler sees every tick even when several were skipped. */
+static void
+advance_ticks (int n) {
+	while (n-- > 0) {
+		ticks++;
+		thread_tick ();
+	}
+}
+
+/* Returns the first tick after the current one at which the wheel
+   has work: a level-0 slot that holds a timer, or a cascade.  Looks
+   at most LIMIT ticks ahead. */
+static int64_t
+wheel_next_deadline (int limit) {
+	ASSERT (wheel_now == ticks + 1);
+	for (int k = 1; k < limit; k++) {
+		int64_t t = ticks + k;
+		if ((t & WHEEL_MASK) == 0 || !list_empty (&wheel[0][t & WHEEL_MASK]))
+			return t;
+	}
+	return ticks + limit;
+}
+
+/* Programs counter 0 to interrupt every tick. */
+static void
+pit_periodic (void) {
+	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	outb (0x40, pit_count & 0xff);
+	outb (0x40, pit_count >> 8);
+}
+
+/* Programs counter 0 to interrupt once, COUNT input clocks from now. */
+static void
+pit_oneshot (uint16_t count) {
+	outb (0x43, 0x30);    /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
+}
+
+/* Returns counter 0's current count. */
+static uint16_t
+pit_read (void) {
+	outb (0x43, 0x00);    /* Counter latch command for counter 0. */
+	uint8_t lo = inb (0x40);
+	uint8_t hi = inb (0x40);
+	return lo | (hi << 8);
+}
+
+/* Latches counter 0's status and count with the read-back command.
+   Stores the count in *COUNT and returns true if the OUT pin is
+   high, i.e. a mode 0 count has already reached zero. */
+static bool
+pit_read_back (uint16_t *count) {
+	outb (0x43, 0xc2);    /* Read-back: latch count and status of counter 0. */
+	uint8_t status = inb (0x40);
+	uint8_t lo = inb (0x40);
+	uint8_t hi = inb (0x40);
+	*count = lo | (hi << 8);
+	return (status & 0x80) != 0;
+}
+
+/* Files TIMER in the slot of the lowest level whose span covers its
+   distance from wheel_now.  Interrupts must be off. */
+static void
+wheel_add (struct timer *timer) {
+	int64_t expires = timer->expires;
+	int64_t delta = expires - wheel_now;
+	int level;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (delta < 0)
+		expires = wheel_now;
+	else if (delta >= WHEEL_SPAN (WHEEL_LEVELS))
+		expires = wheel_now + WHEEL_SPAN (WHEEL_LEVELS) - 1;
+	delta = expires - wheel_now;
+
+	for (level = 0; level < WHEEL_LEVELS - 1; level++)
+		if (delta < WHEEL_SPAN (level + 1))
+			break;
+	int slot = (expires >> (level * WHEEL_BITS)) & WHEEL_MASK;
+	list_push_back (&wheel[level][slot], &timer->elem);
+}
+
+/* Re-files every timer in LEVEL's current slot into lower levels. */
+static void
+wheel_cascade (int level) {
+	int slot = (wheel_now >> (level * WHEEL_BITS)) & WHEEL_MASK;
+	struct list *bucket = &wheel[level][slot];
+	struct list moved;
+
+	list_init (&moved);
+	while (!list_empty (bucket))
+		list_push_back (&moved, list_pop_front (bucket));
+	while (!list_empty (&moved)) {
+		struct timer *timer = list_entry (list_pop_front (&moved), struct timer, elem);
+		wheel_add (timer);
+	}
+}
+
+/* Advances the wheel up to the current tick, firing what expired.
+   The due bucket is detached and wheel_now advanced before any
+   callback runs, so a callback that re-arms a timer for a deadline
+   that has already passed lands on the following tick instead of
+   firing again in this loop. */
+static void
+wheel_run (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	while (wheel_now <= ticks) {
+		int slot = wheel_now & WHEEL_MASK;
+		for (int level = 1; slot == 0 && level < WHEEL_LEVELS; level++) {
+			wheel_cascade (level);
+			slot = (wheel_now >> (level * WHEEL_BITS)) & WHEEL_MASK;
+		}
+
+		struct list *bucket = &wheel[0][wheel_now & WHEEL_MASK];
+		struct list due;
+		list_init (&due);
+		while (!list_empty (bucket))
+			list_push_back (&due, list_pop_front (bucket));
+		wheel_now++;
+
+		while (!list_empty (&due)) {
+			struct timer *timer = list_entry (list_pop_front (&due), struct timer, elem);
+			timer->pending = false;
+			timer->func (timer, timer->aux);
+		}
+	}
+}
+
+/* timer_sleep() callback: makes the sleeping THREAD runnable. */
+static void
+wake_sleeper (struct timer *timer UNUSED, void *thread) {
+	thread_unblock (thread);
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -172,7 +474,11 @@ real_time_sleep (int64_t num, int32_t denom) {
 	int64_t ticks = num * TIMER_FREQ / denom;
 
 	ASSERT (intr_get_level () == INTR_ON);
-	if (ticks > 0) {
+	if (hrtimer_ready ()) {
+		/* Block until the exact deadline. */
+		ASSERT (NSEC_PER_SEC % denom == 0);
+		hrtimer_sleep (num * (NSEC_PER_SEC / denom));
+	} else if (ticks > 0) {
 		/* We're waiting for at least one full timer tick.  Use
 		   timer_sleep() because it will yield the CPU to other
 		   processes. */
@@ -14,7 +14,7 @@ file_open (struct inode *inode) {
 		file->pos = 0;
 		file->deny_write = false;
 		file->ref_cnt = 1;
-		file->is_duplicated = false;
+		file->fork_copy = NULL;
 		return file;
 	} else {
 		inode_close (inode);
@@ -5,7 +5,9 @@
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -36,6 +38,9 @@ struct inode {
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+	bool loaded;                        /* True once DATA has been read. */
+	struct lock lock;                   /* Guards removed, deny_write_cnt; serializes writers. */
+	struct lock dir_lock;               /* Held by directory.c while it scans or edits entries. */
 	struct inode_disk data;             /* Inode content. */
 };
 
@@ -53,13 +58,61 @@ byte_to_sector (const struct inode *inode, off_t pos) {
 }
 
 /* List of open inodes, so that opening a single inode twice
- * returns the same `struct inode'. */
+ * returns the same `struct inode'.  Lookups take OPEN_INODES_LOCK for
+ * reading, insertion and removal take it for writing; it is never held
+ * across disk I/O.  open_cnt is only changed with interrupts off, since
+ * lookups bump it while other readers are in the list too. */
 static struct list open_inodes;
+static struct rwlock open_inodes_lock;
 
 /* Initializes the inode module. */
 void
 inode_init (void) {
 	list_init (&open_inodes);
+	rwlock_init (&open_inodes_lock);
+}
+
+/* Prints inode module statistics. */
+void
+inode_print_stats (void) {
+	rwlock_print_stats (&open_inodes_lock, "Open inodes lock");
+}
+
+/* Adds DELTA to INODE's open count and returns the new count. */
+static int
+inode_adjust_open_cnt (struct inode *inode, int delta) {
+	enum intr_level old_level = intr_disable ();
+	int open_cnt = inode->open_cnt += delta;
+	intr_set_level (old_level);
+	return open_cnt;
+}
+
+/* Returns the open inode for SECTOR with its open count bumped, or a
+ * null pointer.  The caller must hold OPEN_INODES_LOCK in either mode. */
+static struct inode *
+open_inodes_find (disk_sector_t sector) {
+	struct list_elem *e;
+
+	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+			e = list_next (e)) {
+		struct inode *inode = list_entry (e, struct inode, elem);
+		if (inode->sector == sector) {
+			inode_adjust_open_cnt (inode, 1);
+			return inode;
+		}
+	}
+	return NULL;
+}
+
+/* Waits until the first opener of INODE has read it in; the first
+ * opener holds INODE->lock until then. */
+static struct inode *
+inode_wait_loaded (struct inode *inode) {
+	if (!inode->loaded) {
+		lock_acquire (&inode->lock);
+		lock_release (&inode->lock);
+	}
+	return inode;
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -104,31 +157,45 @@ inode_create (disk_sector_t sector, off_t length) {
  * Returns a null pointer if memory allocation fails. */
 struct inode *
 inode_open (disk_sector_t sector) {
-	struct list_elem *e;
-	struct inode *inode;
+	struct inode *inode, *open;
 
 	/* Check whether this inode is already open. */
-	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-			e = list_next (e)) {
-		inode = list_entry (e, struct inode, elem);
-		if (inode->sector == sector) {
-			inode_reopen (inode);
-			return inode; 
-		}
-	}
+	rwlock_acquire_read (&open_inodes_lock);
+	open = open_inodes_find (sector);
+	rwlock_release_read (&open_inodes_lock);
+	if (open != NULL)
+		return inode_wait_loaded (open);
 
 	/* Allocate memory. */
 	inode = malloc (sizeof *inode);
 	if (inode == NULL)
 		return NULL;
 
+	/* Someone may have opened it while we were not holding the lock. */
+	rwlock_acquire_write (&open_inodes_lock);
+	open = open_inodes_find (sector);
+	if (open != NULL) {
+		rwlock_release_write (&open_inodes_lock);
+		free (inode);
+		return inode_wait_loaded (open);
+	}
+
 	/* Initialize. */
-	list_push_front (&open_inodes, &inode->elem);
 	inode->sector = sector;
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
+	inode->loaded = false;
+	lock_init (&inode->lock);
+	lock_init (&inode->dir_lock);
+	lock_acquire (&inode->lock);
+	list_push_front (&open_inodes, &inode->elem);
+	rwlock_release_write (&open_inodes_lock);
+
+	/* Read it in without blocking opens of other inodes. */
 	disk_read (filesys_disk, inode->sector, &inode->data);
+	inode->loaded = true;
+	lock_release (&inode->lock);
 	return inode;
 }
 
@@ -136,7 +203,7 @@ inode_open (disk_sector_t sector) {
 struct inode *
 inode_reopen (struct inode *inode) {
 	if (inode != NULL)
-		inode->open_cnt++;
+		inode_adjust_open_cnt (inode, 1);
 	return inode;
 }
 
@@ -156,10 +223,13 @@ inode_close (struct inode *inode) {
 		return;
 
 	/* Release resources if this was the last opener. */
-	if (--inode->open_cnt == 0) {
-		/* Remove from inode list and release lock. */
+	rwlock_acquire_write (&open_inodes_lock);
+	bool last = inode_adjust_open_cnt (inode, -1) == 0;
+	if (last)
 		list_remove (&inode->elem);
+	rwlock_release_write (&open_inodes_lock);
 
+	if (last) {
 		/* Deallocate blocks if removed. */
 		if (inode->removed) {
 			free_map_release (inode->sector, 1);
@@ -176,12 +246,16 @@ inode_close (struct inode *inode) {
 void
 inode_remove (struct inode *inode) {
 	ASSERT (inode != NULL);
+	lock_acquire (&inode->lock);
 	inode->removed = true;
+	lock_release (&inode->lock);
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
  * Returns the number of bytes actually read, which may be less
- * than SIZE if an error occurs or end of file is reached. */
+ * than SIZE if an error occurs or end of file is reached.
+ * Takes no lock: an inode's extent never changes while it is open,
+ * so readers of any inode may wait on the disk concurrently. */
 off_t
 inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	uint8_t *buffer = buffer_;
@@ -239,8 +313,13 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size, off_t offs
 	off_t bytes_written = 0;
 	uint8_t *bounce = NULL;
 
-	if (inode->deny_write_cnt)
+	/* Writers of one inode are serialized so that partial-sector
+	 * read-modify-write cycles cannot interleave. */
+	lock_acquire (&inode->lock);
+	if (inode->deny_write_cnt) {
+		lock_release (&inode->lock);
 		return 0;
+	}
 
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
@@ -284,6 +363,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size, off_t offs
 		offset += chunk_size;
 		bytes_written += chunk_size;
 	}
+	lock_release (&inode->lock);
 	free (bounce);
 
 	return bytes_written;
@@ -294,8 +374,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size, off_t offs
 	void
 inode_deny_write (struct inode *inode) 
 {
+	lock_acquire (&inode->lock);
 	inode->deny_write_cnt++;
 	ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+	lock_release (&inode->lock);
 }
 
 /* Re-enables writes to INODE.
@@ -303,9 +385,26 @@ inode_deny_write (struct inode *inode)
  * inode_deny_write() on the inode, before closing the inode. */
 void
 inode_allow_write (struct inode *inode) {
+	lock_acquire (&inode->lock);
 	ASSERT (inode->deny_write_cnt > 0);
 	ASSERT (inode->deny_write_cnt <= inode->open_cnt);
 	inode->deny_write_cnt--;
+	lock_release (&inode->lock);
+}
+
+/* Acquires the directory lock of INODE.  directory.c holds it
+ * while it scans or rewrites entries, so that a lookup and the
+ * update that depends on it are atomic with respect to other
+ * operations on the same directory. */
+void
+inode_dir_lock (struct inode *inode) {
+	lock_acquire (&inode->dir_lock);
+}
+
+/* Releases the directory lock of INODE. */
+void
+inode_dir_unlock (struct inode *inode) {
+	lock_release (&inode->dir_lock);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
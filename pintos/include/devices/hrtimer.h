@@ -0,0 +1,18 @@
+#ifndef DEVICES_HRTIMER_H
+#define DEVICES_HRTIMER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define NSEC_PER_SEC 1000000000LL
+
+void hrtimer_init (void);
+void hrtimer_calibrate (void);
+bool hrtimer_ready (void);
+uint64_t hrtimer_tsc_hz (void);
+
+uint64_t hrtimer_now (void);
+uint64_t hrtimer_cycles_to_ns (uint64_t cycles);
+void hrtimer_sleep (int64_t ns);
+
+#endif /* devices/hrtimer.h */
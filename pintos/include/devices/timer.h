@@ -1,12 +1,30 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* A one-shot kernel timer.  Once timer_ticks() reaches EXPIRES,
+   FUNC(TIMER, AUX) is called from the timer interrupt handler, with
+   interrupts off; it must not sleep.  The struct is owned by the
+   caller and may live on its stack as long as the timer is
+   cancelled or has fired before the frame goes away. */
+struct timer;
+typedef void timer_func (struct timer *, void *aux);
+
+struct timer {
+	int64_t expires;            /* Absolute tick to fire at. */
+	timer_func *func;           /* Callback. */
+	void *aux;                  /* Callback argument. */
+	bool pending;               /* On the wheel? */
+	struct list_elem elem;      /* Wheel slot list element. */
+};
+
 void timer_init (void);
 void timer_calibrate (void);
 
@@ -18,6 +36,16 @@ void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
 
+void timer_setup (struct timer *, timer_func *, void *aux);
+void timer_arm (struct timer *, int64_t expires);
+bool timer_cancel (struct timer *);
+
+/* Dynamic ticks in the idle thread ("-tickless"). */
+extern bool timer_tickless;
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+int64_t timer_suppressed_ticks (void);
+
 void timer_print_stats (void);
 
 #endif /* devices/timer.h */
@@ -11,8 +11,8 @@ struct file {
 	struct inode *inode;        /* File's inode. */
 	off_t pos;                  /* Current position. */
 	bool deny_write;            /* Has file_deny_write() been called? */
-	int ref_cnt;
-	bool is_duplicated;
+	int ref_cnt;                /* Descriptors referring to this file. */
+	struct file *fork_copy;     /* Child's copy while fork duplicates fds. */
 };
 
 /* Opening and closing files. */
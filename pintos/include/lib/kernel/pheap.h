@@ -0,0 +1,54 @@
+#ifndef __LIB_KERNEL_PHEAP_H
+#define __LIB_KERNEL_PHEAP_H
+
+/* Pairing heap (max-heap).
+ *
+ * Like lists and hash tables, the heap does no allocation: each
+ * structure that can be in a heap embeds a struct pheap_elem, and
+ * pheap_entry() converts an element back to its structure.
+ *
+ * pheap_top() is O(1), pheap_insert() O(1), and pheap_pop(),
+ * pheap_remove() and pheap_update() O(log n) amortized.  Any element
+ * can be removed, not just the top, which is what makes the heap
+ * usable for keys that change while the element is queued: call
+ * pheap_update() after changing an element's key.  Changing a key
+ * without doing so leaves the heap corrupt. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct pheap_elem {
+	struct pheap_elem *child;   /* Leftmost child. */
+	struct pheap_elem *next;    /* Right sibling. */
+	struct pheap_elem *prev;    /* Left sibling, or parent if leftmost. */
+};
+
+/* Converts pointer to heap element PHEAP_ELEM into a pointer to
+ * the structure that PHEAP_ELEM is embedded inside. */
+#define pheap_entry(PHEAP_ELEM, STRUCT, MEMBER)                 \
+	((STRUCT *) ((uint8_t *) &(PHEAP_ELEM)->child           \
+		- offsetof (STRUCT, MEMBER.child)))
+
+/* Returns true if A's key is less than B's, given auxiliary data
+ * AUX. */
+typedef bool pheap_less_func (const struct pheap_elem *a,
+		const struct pheap_elem *b, void *aux);
+
+/* Heap. */
+struct pheap {
+	struct pheap_elem *root;    /* Greatest element, or NULL. */
+	pheap_less_func *less;      /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `less'. */
+};
+
+void pheap_init (struct pheap *, pheap_less_func *, void *aux);
+bool pheap_empty (const struct pheap *);
+struct pheap_elem *pheap_top (const struct pheap *);
+void pheap_insert (struct pheap *, struct pheap_elem *);
+struct pheap_elem *pheap_pop (struct pheap *);
+void pheap_remove (struct pheap *, struct pheap_elem *);
+void pheap_update (struct pheap *, struct pheap_elem *);
+
+#endif /* lib/kernel/pheap.h */
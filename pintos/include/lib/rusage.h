@@ -0,0 +1,15 @@
+#ifndef __LIB_RUSAGE_H
+#define __LIB_RUSAGE_H
+
+#include <stdint.h>
+
+/* CPU time used by a process, as returned by getrusage().  All times
+   are in nanoseconds. */
+struct rusage {
+	int64_t ru_utime;           /* Running user code. */
+	int64_t ru_stime;           /* In system calls and interrupts. */
+	int64_t ru_ftime;           /* Resolving page faults. */
+	int64_t ru_iotime;          /* Blocked on disk I/O. */
+};
+
+#endif /* lib/rusage.h */
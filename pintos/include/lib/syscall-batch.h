@@ -0,0 +1,76 @@
+#ifndef __LIB_SYSCALL_BATCH_H
+#define __LIB_SYSCALL_BATCH_H
+
+#include <stdint.h>
+
+/* Batched system calls.
+
+   The process queues ordinary file system calls in a ring in its own
+   memory and runs the whole batch with one batch_enter(), saving a
+   trap per call.  The calls run one after another in the calling
+   thread, and batch_enter() returns when they are all done; nothing
+   runs before it is called.
+
+   The ring is a struct batch_ring followed by ENTRIES submission
+   entries and then ENTRIES completion entries, where ENTRIES is a power
+   of two no larger than BATCH_MAX, registered with batch_setup().  The
+   process fills submission entries and advances sq_tail; the kernel
+   advances sq_head and cq_tail; the process consumes completions and
+   advances cq_head.  All four indices run freely and are reduced modulo
+   ENTRIES. */
+
+#define BATCH_MAX 4096
+
+/* Operations that can be queued. */
+enum batch_op {
+	BATCH_NOP,                  /* Completes with result 0. */
+	BATCH_READ,                 /* read(), or pread() if OFFSET >= 0. */
+	BATCH_WRITE,                /* write(), or pwrite() if OFFSET >= 0. */
+	BATCH_OPEN,                 /* open() the file named by ADDR. */
+	BATCH_CLOSE,                /* close(). */
+};
+
+/* Submission queue entry. */
+struct batch_sqe {
+	uint32_t op;                /* One of enum batch_op. */
+	int32_t fd;                 /* File descriptor. */
+	uint64_t addr;              /* Buffer or file name. */
+	uint32_t len;               /* Buffer length. */
+	int32_t offset;             /* File offset, or -1 for the position. */
+	uint64_t user_data;         /* Handed back untouched in the CQE. */
+};
+
+/* Completion queue entry. */
+struct batch_cqe {
+	uint64_t user_data;         /* From the matching submission. */
+	int64_t result;             /* What the plain syscall would return. */
+};
+
+/* Ring header. */
+struct batch_ring {
+	uint32_t sq_head;           /* Next submission the kernel takes. */
+	uint32_t sq_tail;           /* Next free submission slot. */
+	uint32_t cq_head;           /* Next completion the process takes. */
+	uint32_t cq_tail;           /* Next free completion slot. */
+	uint32_t entries;           /* Set by batch_setup(). */
+	uint32_t pad;
+};
+
+/* Bytes of memory needed for a ring of ENTRIES entries. */
+#define BATCH_RING_SIZE(ENTRIES) \
+	(sizeof (struct batch_ring) \
+	 + (ENTRIES) * (sizeof (struct batch_sqe) + sizeof (struct batch_cqe)))
+
+/* Returns RING's submission array. */
+static inline struct batch_sqe *
+batch_sq (struct batch_ring *ring) {
+	return (struct batch_sqe *) (ring + 1);
+}
+
+/* Returns RING's completion array. */
+static inline struct batch_cqe *
+batch_cq (struct batch_ring *ring) {
+	return (struct batch_cqe *) (batch_sq (ring) + ring->entries);
+}
+
+#endif /* lib/syscall-batch.h */
@@ -36,6 +36,26 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Vectored and positional I/O. */
+	SYS_READV,                  /* Read from a file into several buffers. */
+	SYS_WRITEV,                 /* Write to a file from several buffers. */
+	SYS_PREAD,                  /* Read from a file at a given offset. */
+	SYS_PWRITE,                 /* Write to a file at a given offset. */
+	SYS_SENDFILE,               /* Copy between two fds inside the kernel. */
+	SYS_BATCH_SETUP,            /* Register a ring of batched syscalls. */
+	SYS_BATCH_ENTER,            /* Run every syscall queued on the ring. */
+	SYS_PIPE,                   /* Create a pipe. */
+	SYS_SHM_MAP,                /* Map a shared memory segment. */
+	SYS_SHM_UNMAP,              /* Unmap a shared memory segment. */
+	SYS_SHM_UNLINK,             /* Remove a named shared memory segment. */
+	SYS_SBRK,                   /* Move the program break. */
+	SYS_MADVISE,                /* Give advice about a memory range. */
+	SYS_NANOSLEEP,              /* Sleep with nanosecond resolution. */
+	SYS_GETRUSAGE,              /* Report the process's CPU time. */
+	SYS_FUTEX_WAIT,             /* Sleep while a futex word holds a value. */
+	SYS_FUTEX_WAKE,             /* Wake threads sleeping on a futex word. */
+	SYS_WAIT_TIMEOUT,           /* Wait for a child, with a deadline. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -4,6 +4,10 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <uio.h>
+#include <syscall-batch.h>
+#include <rusage.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -13,6 +17,10 @@ typedef int pid_t;
 typedef int off_t;
 #define MAP_FAILED ((void *) NULL)
 
+/* Advice for madvise(). */
+#define MADV_NORMAL 0           /* No special treatment. */
+#define MADV_DONTNEED 4         /* Drop heap and stack pages; they read back as zeros. */
+
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
@@ -26,6 +34,7 @@ void exit (int status) NO_RETURN;
 pid_t fork (const char *thread_name);
 int exec (const char *file);
 int wait (pid_t);
+int wait_timeout (pid_t, int milliseconds, int *status);
 bool create (const char *file, unsigned initial_size);
 bool remove (const char *file);
 int open (const char *file);
@@ -38,9 +47,27 @@ void close (int fd);
 
 int dup2(int oldfd, int newfd);
 
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, off_t offset);
+int pwrite (int fd, const void *buffer, unsigned length, off_t offset);
+int sendfile (int out_fd, int in_fd, unsigned length);
+int batch_setup (struct batch_ring *ring, unsigned entries);
+int batch_enter (void);
+int pipe (int fds[2]);
+int nanosleep (int64_t nanoseconds);
+int getrusage (struct rusage *usage);
+int futex_wait (int *addr, int val);
+int futex_wake (int *addr, int count);
+
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
+void *shm_map (const char *name, void *addr, size_t length);
+void shm_unmap (void *addr);
+bool shm_unlink (const char *name);
+void *sbrk (intptr_t increment);
+int madvise (void *addr, size_t length, int advice);
 
 /* Project 4 only. */
 bool chdir (const char *dir);
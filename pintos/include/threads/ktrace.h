@@ -0,0 +1,58 @@
+#ifndef THREADS_KTRACE_H
+#define THREADS_KTRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Kernel event tracing.
+
+   With kernel command-line option "-ktrace", the kernel records the
+   events below into a ring of fixed-size records, stamped with the
+   TSC, and the ring is written to the serial port at power-off
+   or whenever ktrace_dump() is called.  utils/ktrace turns the dump
+   back into a timeline.
+
+   The tracepoints compile to nothing unless the kernel is built with
+   KTRACE defined, which Make.config does unless "make KTRACE=0". */
+
+/* Event types.  ARG and AUX are as noted; the thread is always the
+   one running when the event was recorded. */
+enum ktrace_type {
+	KT_SWITCH = 1,              /* ARG: next tid; AUX: old status. */
+	KT_WAKEUP,                  /* ARG: woken tid; AUX: its priority. */
+	KT_FAULT,                   /* ARG: fault address; AUX: PF_* bits. */
+	KT_SYSCALL,                 /* AUX: system call number. */
+	KT_SYSRET,                  /* ARG: value in rax on return. */
+	KT_LOCK_WAIT,               /* ARG: lock address; AUX: holder tid. */
+	KT_LOCK_GOT,                /* ARG: lock address, after a wait. */
+	KT_DISK,                    /* ARG: sector; AUX: disk << 1 | write. */
+	KT_DISK_DONE,               /* As KT_DISK. */
+};
+
+/* One recorded event.  24 bytes. */
+struct ktrace_rec {
+	uint64_t tsc;               /* rdtsc() when recorded. */
+	uint64_t arg;
+	int32_t tid;
+	uint16_t aux;
+	uint8_t type;               /* enum ktrace_type. */
+	uint8_t pad;
+};
+
+extern bool ktrace_enabled;
+
+void ktrace_init (void);
+void ktrace_log (enum ktrace_type, uint64_t arg, unsigned aux);
+void ktrace_dump (void);
+
+#ifdef KTRACE
+#define KTRACE_EVENT(TYPE, ARG, AUX)                            \
+	do {                                                        \
+		if (ktrace_enabled)                                     \
+			ktrace_log (TYPE, (uint64_t) (ARG), AUX);           \
+	} while (0)
+#else
+#define KTRACE_EVENT(TYPE, ARG, AUX) ((void) 0)
+#endif
+
+#endif /* threads/ktrace.h */
@@ -0,0 +1,46 @@
+#ifndef THREADS_SCHED_H
+#define THREADS_SCHED_H
+
+#include <list.h>
+#include <stdint.h>
+#include "threads/spinlock.h"
+#include "threads/thread.h"
+
+/* Scheduler state, gathered in one place.  Owned by thread.c.
+
+   Everything but the run queue is only touched with interrupts off;
+   the run queue is guarded by RQ_LOCK. */
+struct sched {
+	/* Run queue: one FIFO per priority, and bit P of READY_MASK set
+	   iff READY_QUEUES[P] is non-empty. */
+	struct spinlock rq_lock;
+	struct list ready_queues[PRI_MAX + 1];
+	uint64_t ready_mask;
+	int ready_cnt;              /* # of threads in all ready queues. */
+
+	/* Under -cfs the ready threads live in CFS_QUEUE instead, ordered
+	   by least vruntime.  MIN_VRUNTIME never decreases. */
+	struct pheap cfs_queue;
+	int64_t min_vruntime;
+
+	struct thread *curr;        /* Running thread. */
+	struct thread *idle_thread; /* Runs when the queue is empty. */
+	struct list destruction_req; /* Dead threads whose pages are still to free. */
+	struct list tcb_cache;      /* Recycled thread pages, see tcb_alloc(). */
+	int tcb_cached;             /* # of pages in TCB_CACHE. */
+	unsigned thread_ticks;      /* # of timer ticks since last yield. */
+
+	/* Statistics. */
+	long long idle_ticks;       /* # of timer ticks spent idle. */
+	long long kernel_ticks;     /* # of timer ticks in kernel threads. */
+	long long user_ticks;       /* # of timer ticks in user programs. */
+	long long creates;          /* # of thread_create() calls that succeeded. */
+	long long create_hits;      /* # of those served from TCB_CACHE. */
+	uint64_t create_cycles;     /* TSC cycles spent in thread_create(). */
+	long long exits;            /* # of threads that exited. */
+	uint64_t exit_cycles;       /* TSC cycles from thread_exit() to reclaim. */
+};
+
+extern struct sched sched;
+
+#endif /* threads/sched.h */
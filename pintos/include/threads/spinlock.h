@@ -0,0 +1,26 @@
+#ifndef THREADS_SPINLOCK_H
+#define THREADS_SPINLOCK_H
+
+#include <stdbool.h>
+#include "threads/interrupt.h"
+
+/* A lock held with interrupts off.
+
+   Acquiring a spinlock disables interrupts, so the holder can be
+   neither preempted nor re-entered by an interrupt handler;
+   spinlock_release() puts back the level that spinlock_acquire()
+   returned, in the same way as intr_disable()/intr_set_level().  This
+   kernel runs on one CPU, so that is all the excluding there is to
+   do: the lock only names the data it guards and lets
+   spinlock_held() assert ownership.  Never sleep while holding one. */
+struct spinlock {
+	bool held;                  /* True while held. */
+	const char *name;           /* For debugging. */
+};
+
+void spinlock_init (struct spinlock *, const char *name);
+enum intr_level spinlock_acquire (struct spinlock *);
+void spinlock_release (struct spinlock *, enum intr_level);
+bool spinlock_held (const struct spinlock *);
+
+#endif /* threads/spinlock.h */
@@ -0,0 +1,37 @@
+#ifndef THREADS_SWITCH_H
+#define THREADS_SWITCH_H
+
+#include <stdint.h>
+
+/* Kernel-to-kernel thread switch.
+
+   Every switch happens inside schedule(), a C function called from
+   kernel code, so only the registers the ABI makes callee-saved have
+   to survive it.  switch_to() pushes those on the old thread's
+   stack, saves the stack pointer, loads the new thread's, and pops
+   its registers back, finishing with a plain ret.  A return to user
+   mode still goes through the interrupt frame the entry path left on
+   the kernel stack, and so through iretq. */
+
+/* What switch_to() leaves at a switched-out thread's saved stack
+   pointer, lowest address first. */
+struct switch_frame {
+	uint64_t r15;
+	uint64_t r14;
+	uint64_t r13;
+	uint64_t r12;
+	uint64_t rbp;
+	uint64_t rbx;
+	void (*rip) (void);         /* Where switch_to() returns. */
+};
+
+/* Saves the running thread's stack pointer in *SAVE_RSP and resumes
+   the thread whose stack pointer is NEXT_RSP.  Interrupts must be
+   off. */
+void switch_to (uint64_t *save_rsp, uint64_t next_rsp);
+
+/* First code run by a new thread.  Calls the function in its
+   frame's RBX as F (R12, R13). */
+void switch_entry (void);
+
+#endif /* threads/switch.h */
@@ -2,16 +2,21 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <pheap.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include "threads/spinlock.h"
 
 /* A counting semaphore. */
 struct semaphore {
+	struct spinlock guard;      /* Protects VALUE and WAITERS. */
 	unsigned value;             /* Current value. */
 	struct list waiters;        /* List of waiting threads. */
 };
 
 void sema_init (struct semaphore *, unsigned value);
 void sema_down (struct semaphore *);
+bool sema_down_timeout (struct semaphore *, int64_t ticks);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
@@ -20,6 +25,8 @@ void sema_self_test (void);
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	struct pheap donors;        /* Waiting threads, by priority. */
+	struct pheap_elem holder_elem; /* In holder->held_locks. */
 };
 
 void lock_init (struct lock *);
@@ -28,6 +35,31 @@ bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+/* Readers-writer lock. */
+struct rwlock {
+	struct lock gate;           /* Held by the writer, briefly by readers. */
+	struct semaphore drained;   /* Upped when the last reader leaves. */
+	struct spinlock guard;      /* Protects READERS and WRITER_WAITING. */
+	unsigned readers;           /* Number of threads holding read access. */
+	bool writer_waiting;        /* Writer holds GATE, waits for READERS == 0. */
+	struct list read_holds;     /* Readers' struct read_hold, for donation. */
+	struct thread *drainer;     /* Writer waiting for READ_HOLDS to drain. */
+
+	/* Contention statistics. */
+	unsigned long long read_acquires;   /* Successful read acquisitions. */
+	unsigned long long read_contended;  /* ...that had to wait for a writer. */
+	unsigned long long write_acquires;  /* Successful write acquisitions. */
+	unsigned long long write_contended; /* ...that had to wait for anyone. */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+void rwlock_print_stats (const struct rwlock *, const char *name);
+
 /* Condition variable. */
 struct condition {
 	struct list waiters;        /* List of waiting threads. */
@@ -35,6 +67,7 @@ struct condition {
 
 void cond_init (struct condition *);
 void cond_wait (struct condition *, struct lock *);
+bool cond_wait_timeout (struct condition *, struct lock *, int64_t ticks);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
@@ -4,15 +4,21 @@
 #include "threads/interrupt.h"
 #include <debug.h>
 #include <list.h>
+#include <pheap.h>
 #include <stdint.h>
 #ifdef VM
 #include "vm/vm.h"
 #endif
 
 struct lock;
+struct rwlock;
+struct spinlock;
+struct rusage;
 struct file;
+struct file_descriptor;
 #ifdef USERPROG
 struct sync_to_parent;
+struct batch_ring;
 #endif
 
 /* States in a thread's life cycle. */
@@ -33,6 +39,35 @@ typedef int tid_t;
 #define PRI_DEFAULT 31 /* Default priority. */
 #define PRI_MAX 63     /* Highest priority. */
 
+/* What a thread's CPU time is being charged to.  See
+   thread_acct_enter(). */
+enum cpu_acct {
+  ACCT_SYS,    /* Kernel code: kernel threads, syscalls, interrupts. */
+  ACCT_USER,   /* User code. */
+  ACCT_FAULT,  /* Resolving a page fault. */
+  ACCT_IOWAIT, /* Blocked on disk I/O; charged off-CPU too. */
+  ACCT_CNT
+};
+
+/* Read access a thread holds on an rwlock, so that a writer waiting
+   for the readers to drain can donate to them.  Holds beyond
+   READ_HOLD_MAX still work but receive no donation. */
+#define READ_HOLD_MAX 4
+struct read_hold {
+  struct rwlock *rw;      /* Lock read, or NULL if the slot is free. */
+  struct thread *thread;  /* The reader. */
+  struct list_elem elem;  /* In rw->read_holds. */
+};
+
+/* A point in the MLFQS recent_cpu decay: the product of the
+   coefficients so far, P = P_MANT * 2^P_EXP, and the weight S that nice
+   has built up over them.  See thread.c. */
+struct decay_mark {
+  uint32_t p_mant;           /* In [2^31, 2^32). */
+  int64_t p_exp;
+  int64_t s;                 /* Q20. */
+};
+
 /* A kernel thread or user process.
  *
  * Each thread structure is stored in its own 4 kB page.  The
@@ -98,42 +133,57 @@ struct thread {
   int priority;              /* Priority. */
   int nice;
   int recent_cpu;
+  int64_t mlfqs_epoch;       /* Last load_avg second folded into recent_cpu. */
+  struct decay_mark mlfqs_mark; /* Decay totals as of MLFQS_EPOCH. */
+  uint64_t exit_start;       /* TSC when thread_exit() was called. */
+  int64_t vruntime;          /* Weighted ticks run, under -cfs. */
+  struct pheap_elem cfs_elem; /* In sched.cfs_queue. */
+  bool is_idle;              /* The idle thread. */
   int exit_status;
+  enum cpu_acct acct_state;  /* Bucket now being charged. */
+  uint64_t acct_stamp;       /* TSC when ACCT_STATE was last charged. */
+  uint64_t acct[ACCT_CNT];   /* TSC cycles charged to each bucket. */
 
   int original_priority;
   struct lock *waiting_for;
-  struct list donators;
+  struct pheap held_locks;   /* edward: locks held, by their best waiter */
+  struct pheap_elem donor_elem; /* edward: in waiting_for->donors */
+  struct rwlock *draining;   /* edward: writer waiting for its readers */
+  struct read_hold read_holds[READ_HOLD_MAX]; /* edward: rwlocks read */
   /* edward
   list elements must be removed somewhere
   - elem_default: schedule(through destruction_req using def)
-  - elem_donator: thread_remove_lock_donations
+  - donor_elem: thread_lock_acquired
   - elem_integrated: thread_exit
   */
-  struct list_elem elem_default; /* edward: ready_list + sleep_list + waiters (semaphore) */
-  struct list_elem elem_donator; /* edward: exclusively for the "struct list donators" */
-  struct list_elem elem_integrated; /* edward: used for mlfqs */
-  int64_t wakeup_tick;
+  struct list_elem elem_default; /* edward: ready_queues + waiters (semaphore) */
+  struct list_elem elem_integrated; /* edward: every live thread, see thread.c "integrated" */
   int stdin_cnt, stdout_cnt;
 
   struct file *running_file;
 #ifdef USERPROG
   /* Owned by userprog/process.c. */
   uint64_t *pml4;                /* Page map level 4 */
-  struct list file_descriptors;  /* Open file descriptors. */
-  int next_fd;                   /* Next descriptor value. */
-  bool fds_initialized;          /* Lazily init descriptor list. */
+  struct file_descriptor *fd_table; /* Open descriptors, indexed by fd. */
+  uint64_t *fd_map;              /* One bit per fd_table slot in use. */
+  size_t fd_cap;                 /* Number of slots in fd_table. */
+  bool fds_initialized;          /* Lazily init descriptor table. */
   struct list children;          /* Child wait statuses. */
   bool children_initialized;     /* Tracks list initialization. */
   struct sync_to_parent *sync2p; /* Synchronization with parent. */
+  struct batch_ring *batch_ring; /* Registered syscall batch ring. */
+  unsigned batch_entries;        /* Its size, as validated at setup. */
 #endif
 #ifdef VM
   /* Table for whole virtual memory owned by thread. */
   struct supplemental_page_table spt;
   uintptr_t user_rsp;
+  void *heap_start;              /* First byte of the heap. */
+  void *brk;                     /* Current program break. */
 #endif
 
   /* Owned by thread.c. */
-  struct intr_frame tf; /* Information for switching */
+  uint64_t ksp;         /* Saved stack pointer, see switch_to(). */
   unsigned magic;       /* Detects stack overflow. */
 };
 
@@ -142,6 +192,12 @@ struct thread {
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler: weighted virtual
+   runtime, with a thread preemptible after CFS_GRANULARITY ticks.
+   Controlled by kernel command-line option "-cfs[=GRAN]". */
+extern bool thread_cfs;
+extern int cfs_granularity;
+
 void thread_init(void);
 void thread_start(void);
 
@@ -152,6 +208,7 @@ typedef void thread_func(void *aux);
 tid_t thread_create(const char *name, int priority, thread_func *, void *);
 
 void thread_block(void);
+void thread_block_on(struct spinlock *);
 void thread_unblock(struct thread *);
 
 struct thread *thread_current(void);
@@ -159,10 +216,11 @@ tid_t thread_tid(void);
 const char *thread_name(void);
 
 void thread_exit(void) NO_RETURN;
-void thread_sleep(void);
-void thread_wake_up(int64_t current_tick);
 void thread_yield(void);
 
+enum cpu_acct thread_acct_enter(enum cpu_acct);
+void thread_get_rusage(struct rusage *);
+
 int thread_get_priority(void);
 void thread_set_priority(int);
 
@@ -178,8 +236,14 @@ bool thread_cmp_priority_desc(const struct list_elem *a,
                               const struct list_elem *b, void *aux UNUSED);
 bool thread_cmp_priority_asc(const struct list_elem *a,
                              const struct list_elem *b, void *aux UNUSED);
-void thread_refresh_priority(struct thread *t);
-void thread_remove_lock_donations(struct lock *lock);
-void thread_propagate_donation(struct thread *t);
+bool thread_donor_less(const struct pheap_elem *a,
+                       const struct pheap_elem *b, void *aux UNUSED);
+void thread_lock_wait(struct lock *lock);
+void thread_lock_acquired(struct lock *lock);
+void thread_lock_released(struct lock *lock);
+void thread_read_acquired(struct rwlock *rw);
+void thread_read_released(struct rwlock *rw);
+void thread_drain_wait(struct rwlock *rw);
+void thread_drain_done(struct rwlock *rw);
 
 #endif /* threads/thread.h */
@@ -0,0 +1,30 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+
+struct thread;
+
+/* Deferred work.
+
+   An interrupt handler that has more to do than it should with
+   interrupts off queues a work item instead; a kernel worker thread
+   at PRI_MAX runs it as soon as the handler returns, with interrupts
+   on.  A work item is queued at most once at a time. */
+
+typedef void work_func (void *aux);
+
+struct work {
+	work_func *func;            /* Function to run. */
+	void *aux;                  /* Its argument. */
+	bool pending;               /* Queued and not yet started. */
+	struct list_elem elem;      /* In the pending list. */
+};
+
+void workqueue_init (void);
+void work_init (struct work *, work_func *, void *aux);
+bool work_queue (struct work *);
+bool thread_is_worker (const struct thread *);
+
+#endif /* threads/workqueue.h */
@@ -0,0 +1,11 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+/* Returned by futex_wait() when the futex word cannot be read. */
+#define FUTEX_FAULT (-2)
+
+void futex_init (void);
+int futex_wait (const int *uaddr, int val);
+int futex_wake (const int *uaddr, int count);
+
+#endif /* userprog/futex.h */
@@ -31,10 +31,14 @@ struct fork_struct {
   struct sync_to_parent *sync2p;     /* Shared wait state with parent. */
 };
 
+/* Print CPU usage along with each exit message (-rusage). */
+extern bool process_rusage;
+
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
 int process_exec (void *f_name);
 int process_wait (tid_t);
+int process_wait_timeout (tid_t, int64_t timeout, int *status);
 void process_exit (void);
 void process_activate (struct thread *next);
 void init_fds (struct thread *target);
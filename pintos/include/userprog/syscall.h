@@ -3,24 +3,38 @@
 
 #include <stddef.h>
 #include <stdbool.h>
-#include <list.h>
+#include <stdint.h>
 #include "threads/synch.h"
 
 struct thread;
+struct intr_frame;
 struct file;
+struct pipe;
 
-enum fd_kind {FD_STDIN, FD_STDOUT, FD_FILE};
+/* Descriptor table limits.  The table starts at FD_INIT_CAP slots and
+   doubles on demand up to FD_MAX. */
+#define FD_INIT_CAP 16
+#define FD_MAX 8192
+
+enum fd_kind {FD_STDIN, FD_STDOUT, FD_FILE, FD_PIPE_READ, FD_PIPE_WRITE};
+
+#define FD_IS_PIPE(KIND) ((KIND) == FD_PIPE_READ || (KIND) == FD_PIPE_WRITE)
+
+/* One slot of a thread's descriptor table (thread->fd_table). */
 struct file_descriptor {
-	int fd;
 	struct file *file;
-	struct list_elem elem;
+	struct pipe *pipe;          /* For FD_PIPE_READ and FD_PIPE_WRITE. */
 	enum fd_kind fd_kind;
 };
 
 void syscall_init (void);
 int write_handler (int fd, const void *buffer, unsigned length);
 void syscall_process_cleanup (void);
+bool user_access_fixup (struct intr_frame *);
+bool copy_from_user (void *dst, const void *usrc, size_t size);
+bool copy_to_user (void *udst, const void *src, size_t size);
+int64_t strncpy_from_user (char *dst, const char *usrc, size_t size);
 bool syscall_duplicate_fds (struct thread *parent, struct thread *child);
-extern struct lock filesys_lock;
+bool fd_table_init (struct thread *t);
 
 #endif /* userprog/syscall.h */
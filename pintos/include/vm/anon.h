@@ -2,13 +2,27 @@
 #define VM_ANON_H
 #include "vm/vm.h"
 struct page;
+struct frame;
+struct shm_segment;
 enum vm_type;
 
+/* Longest name of a named shared segment. */
+#define SHM_NAME_MAX 14
+
 struct anon_page {
   size_t slot_idx;
+  struct shm_segment *shm;  /* Backing segment if VM_SHARED, else NULL. */
+  size_t shm_idx;           /* Page index within SHM. */
 };
 
 void vm_anon_init(void);
 bool anon_initializer(struct page *page, enum vm_type type, void *kva);
 
+void *anon_shared_map (void *addr, size_t length, const char *name);
+bool anon_shared_unmap (void *addr);
+bool anon_shared_unlink (const char *name);
+bool anon_shared_copy (struct page *src);
+struct frame *anon_shared_frame (struct page *page);
+struct shm_segment *anon_shared_segment (struct page *page, size_t *idx);
+
 #endif
@@ -6,6 +6,10 @@
 
 #define STACK_LIMIT (1 << 20)
 
+/* Advice for vm_madvise(). */
+#define MADV_NORMAL 0           /* No special treatment. */
+#define MADV_DONTNEED 4         /* Drop the frames; refault as zeros. */
+
 enum vm_type {
   /* page not initialized */
   VM_UNINIT = 0,
@@ -23,6 +27,9 @@ enum vm_type {
   VM_MARKER_0 = (1 << 3),
   VM_MARKER_1 = (1 << 4),
 
+  /* Anonymous page backed by a shared segment (see vm/anon.c). */
+  VM_SHARED = (1 << 5),
+
   /* DO NOT EXCEED THIS VALUE. */
   VM_MARKER_END = (1 << 31),
 };
@@ -67,7 +74,7 @@ struct page {
 /* The representation of "frame" */
 struct frame {
 	void *kva;
-	struct page *page;
+	struct page *page;      /* NULL for a shared segment's frame. */
 	struct list_elem frame_elem;
 };
 
@@ -107,6 +114,10 @@ bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user, bool writ
 #define vm_alloc_page(type, upage, writable) vm_alloc_page_with_initializer ((type), (upage), (writable), NULL, NULL)
 bool vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
+struct frame *vm_get_frame (void);
+void vm_free_frame (struct frame *frame);
+void *vm_sbrk (intptr_t increment);
+bool vm_madvise (void *addr, size_t length, int advice);
 bool vm_claim_page (void *va);
 enum vm_type page_get_type (struct page *page);
 
@@ -0,0 +1,143 @@
+/* Pairing heap.  See pheap.h for basic information.
+
+   Every node's key is at least that of each of its children.  A
+   node's children form a doubly linked list through NEXT and PREV,
+   where the leftmost child's PREV points back at the parent. */
+
+#include "pheap.h"
+#include "../debug.h"
+
+static struct pheap_elem *meld (struct pheap *, struct pheap_elem *,
+		struct pheap_elem *);
+static struct pheap_elem *merge_pairs (struct pheap *, struct pheap_elem *);
+static void detach (struct pheap_elem *);
+
+/* Initializes H as an empty heap ordered by LESS, given auxiliary
+   data AUX. */
+void
+pheap_init (struct pheap *h, pheap_less_func *less, void *aux) {
+	ASSERT (h != NULL && less != NULL);
+	h->root = NULL;
+	h->less = less;
+	h->aux = aux;
+}
+
+/* Returns true if H is empty. */
+bool
+pheap_empty (const struct pheap *h) {
+	return h->root == NULL;
+}
+
+/* Returns the greatest element of H, or NULL if H is empty. */
+struct pheap_elem *
+pheap_top (const struct pheap *h) {
+	return h->root;
+}
+
+/* Inserts E, which must not be in any heap, into H. */
+void
+pheap_insert (struct pheap *h, struct pheap_elem *e) {
+	ASSERT (e != NULL);
+	e->child = e->next = e->prev = NULL;
+	h->root = meld (h, h->root, e);
+}
+
+/* Removes and returns the greatest element of H, or NULL if H is
+   empty. */
+struct pheap_elem *
+pheap_pop (struct pheap *h) {
+	struct pheap_elem *top = h->root;
+
+	if (top != NULL) {
+		h->root = merge_pairs (h, top->child);
+		top->child = NULL;
+	}
+	return top;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+pheap_remove (struct pheap *h, struct pheap_elem *e) {
+	ASSERT (e != NULL);
+
+	if (e == h->root) {
+		pheap_pop (h);
+		return;
+	}
+	detach (e);
+	h->root = meld (h, h->root, merge_pairs (h, e->child));
+	e->child = NULL;
+}
+
+/* Restores the heap order around E, which is in H, after its key
+   changed in either direction. */
+void
+pheap_update (struct pheap *h, struct pheap_elem *e) {
+	pheap_remove (h, e);
+	pheap_insert (h, e);
+}
+
+/* Links two heap roots and returns the new root. */
+static struct pheap_elem *
+meld (struct pheap *h, struct pheap_elem *a, struct pheap_elem *b) {
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+	if (h->less (a, b, h->aux)) {
+		struct pheap_elem *t = a;
+		a = b;
+		b = t;
+	}
+
+	/* B becomes A's leftmost child. */
+	b->prev = a;
+	b->next = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	a->child = b;
+	a->next = a->prev = NULL;
+	return a;
+}
+
+/* Combines the sibling list starting at FIRST into one heap with the
+   usual two passes: meld pairs left to right, then fold the results
+   right to left.  Returns the new root. */
+static struct pheap_elem *
+merge_pairs (struct pheap *h, struct pheap_elem *first) {
+	struct pheap_elem *pairs = NULL;        /* Stack, linked by NEXT. */
+	struct pheap_elem *root = NULL;
+
+	while (first != NULL) {
+		struct pheap_elem *a = first;
+		struct pheap_elem *b = a->next;
+		struct pheap_elem *m;
+
+		first = b != NULL ? b->next : NULL;
+		a->next = a->prev = NULL;
+		if (b != NULL)
+			b->next = b->prev = NULL;
+		m = meld (h, a, b);
+		m->next = pairs;
+		pairs = m;
+	}
+	while (pairs != NULL) {
+		struct pheap_elem *next = pairs->next;
+		pairs->next = NULL;
+		root = meld (h, root, pairs);
+		pairs = next;
+	}
+	return root;
+}
+
+/* Unlinks non-root E from its parent and siblings. */
+static void
+detach (struct pheap_elem *e) {
+	if (e->prev->child == e)
+		e->prev->child = e->next;
+	else
+		e->prev->next = e->next;
+	if (e->next != NULL)
+		e->next->prev = e->prev;
+	e->next = e->prev = NULL;
+}
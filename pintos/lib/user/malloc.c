@@ -0,0 +1,224 @@
+#include <malloc.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+
+/* A size-class memory allocator on top of sbrk().
+
+   Requests of up to MAX_SMALL bytes are rounded up to a power of
+   two, starting at 16, and served from pages that hold blocks of a
+   single size.  The header at the start of each page records the
+   size class, so free() can put a block back on the right list.
+   Small-block pages are never handed back to the kernel.
+
+   Larger requests get a run of whole pages, a "span", of their own.
+   Freeing a span at the top of the heap lowers the break.  Any other
+   span goes on a free list, and the pages past its header are handed
+   back with MADV_DONTNEED, so it costs no memory until it is reused.
+
+   Pintos user processes have a single thread, so nothing here needs
+   locking. */
+
+#define PAGE_SIZE 4096
+#define MIN_SHIFT 4                     /* Smallest class: 16 bytes. */
+#define CLASS_CNT 7                     /* 16, 32, ..., 1024 bytes. */
+#define MAX_SMALL (1 << (MIN_SHIFT + CLASS_CNT - 1))
+#define SPAN CLASS_CNT                  /* Class of a span. */
+#define HDR_MAGIC 0x6d616c6c            /* "mall". */
+
+/* Header at the start of every page the allocator hands out blocks
+   from, and of the first page of every span. */
+struct page_hdr {
+	uint32_t magic;                     /* Detects bad pointers. */
+	uint32_t class;                     /* Size class, or SPAN. */
+	size_t page_cnt;                    /* Spans: number of pages. */
+	struct page_hdr *next;              /* Spans: next free span. */
+};
+
+/* Blocks start this far into a page, keeping 16-byte alignment. */
+#define HDR_SIZE ROUND_UP (sizeof (struct page_hdr), 16)
+
+/* A free small block. */
+struct free_block {
+	struct free_block *next;
+};
+
+static struct free_block *free_lists[CLASS_CNT];
+static struct page_hdr *free_spans;
+
+/* Returns the size of blocks in CLASS. */
+static size_t
+class_size (unsigned class) {
+	return (size_t) 1 << (MIN_SHIFT + class);
+}
+
+/* Returns the smallest class whose blocks hold SIZE bytes. */
+static unsigned
+size_class (size_t size) {
+	unsigned class = 0;
+	while (class_size (class) < size)
+		class++;
+	return class;
+}
+
+/* Returns the page header for block P. */
+static struct page_hdr *
+block_hdr (void *p) {
+	struct page_hdr *hdr = (struct page_hdr *) ((uintptr_t) p & ~(uintptr_t) (PAGE_SIZE - 1));
+	ASSERT (hdr->magic == HDR_MAGIC);
+	return hdr;
+}
+
+/* Obtains PAGE_CNT fresh, page-aligned pages from the kernel. */
+static void *
+get_pages (size_t page_cnt) {
+	uint8_t *brk = sbrk (0);
+	if (brk == (void *) -1)
+		return NULL;
+
+	size_t pad = ROUND_UP ((uintptr_t) brk, PAGE_SIZE) - (uintptr_t) brk;
+	if (sbrk (pad + page_cnt * PAGE_SIZE) == (void *) -1)
+		return NULL;
+	return brk + pad;
+}
+
+/* Adds a page worth of blocks to CLASS's free list. */
+static bool
+refill (unsigned class) {
+	struct page_hdr *hdr = get_pages (1);
+	size_t size = class_size (class);
+	size_t ofs;
+
+	if (hdr == NULL)
+		return false;
+	hdr->magic = HDR_MAGIC;
+	hdr->class = class;
+	for (ofs = HDR_SIZE; ofs + size <= PAGE_SIZE; ofs += size) {
+		struct free_block *b = (struct free_block *) ((uint8_t *) hdr + ofs);
+		b->next = free_lists[class];
+		free_lists[class] = b;
+	}
+	return true;
+}
+
+/* Allocates a span with room for SIZE bytes. */
+static void *
+span_alloc (size_t size) {
+	size_t page_cnt = DIV_ROUND_UP (size + HDR_SIZE, PAGE_SIZE);
+	struct page_hdr **prev, *hdr;
+
+	if (size > SIZE_MAX - HDR_SIZE - PAGE_SIZE)
+		return NULL;
+
+	/* First fit among the free spans. */
+	for (prev = &free_spans; *prev != NULL; prev = &(*prev)->next)
+		if ((*prev)->page_cnt >= page_cnt) {
+			hdr = *prev;
+			*prev = hdr->next;
+			return (uint8_t *) hdr + HDR_SIZE;
+		}
+
+	hdr = get_pages (page_cnt);
+	if (hdr == NULL)
+		return NULL;
+	hdr->magic = HDR_MAGIC;
+	hdr->class = SPAN;
+	hdr->page_cnt = page_cnt;
+	return (uint8_t *) hdr + HDR_SIZE;
+}
+
+/* Frees the span with header HDR. */
+static void
+span_free (struct page_hdr *hdr) {
+	size_t bytes = hdr->page_cnt * PAGE_SIZE;
+
+	if ((uint8_t *) hdr + bytes == sbrk (0)) {
+		hdr->magic = 0;
+		sbrk (-(intptr_t) bytes);
+		return;
+	}
+	madvise ((uint8_t *) hdr + PAGE_SIZE, bytes - PAGE_SIZE, MADV_DONTNEED);
+	hdr->next = free_spans;
+	free_spans = hdr;
+}
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
+void *
+malloc (size_t size) {
+	if (size == 0)
+		return NULL;
+	if (size > MAX_SMALL)
+		return span_alloc (size);
+
+	/* Fast path: pop the class's free list. */
+	unsigned class = size_class (size);
+	if (free_lists[class] == NULL && !refill (class))
+		return NULL;
+	struct free_block *b = free_lists[class];
+	free_lists[class] = b->next;
+	return b;
+}
+
+/* Allocates and returns A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void *
+calloc (size_t a, size_t b) {
+	size_t size = a * b;
+	void *p;
+
+	if (b != 0 && size / b != a)
+		return NULL;
+	p = malloc (size);
+	if (p != NULL)
+		memset (p, 0, size);
+	return p;
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly moving it
+   in the process.  If successful, returns the new block; on failure,
+   returns a null pointer.  A call with null OLD_BLOCK is equivalent
+   to malloc(NEW_SIZE).  A call with zero NEW_SIZE is equivalent to
+   free(OLD_BLOCK). */
+void *
+realloc (void *old_block, size_t new_size) {
+	if (new_size == 0) {
+		free (old_block);
+		return NULL;
+	}
+	if (old_block == NULL)
+		return malloc (new_size);
+
+	struct page_hdr *hdr = block_hdr (old_block);
+	size_t old_size = hdr->class == SPAN
+		? hdr->page_cnt * PAGE_SIZE - HDR_SIZE
+		: class_size (hdr->class);
+	if (new_size <= old_size)
+		return old_block;
+
+	void *new_block = malloc (new_size);
+	if (new_block != NULL) {
+		memcpy (new_block, old_block, old_size);
+		free (old_block);
+	}
+	return new_block;
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void
+free (void *p) {
+	if (p == NULL)
+		return;
+
+	struct page_hdr *hdr = block_hdr (p);
+	if (hdr->class == SPAN) {
+		span_free (hdr);
+		return;
+	}
+	struct free_block *b = p;
+	b->next = free_lists[hdr->class];
+	free_lists[hdr->class] = b;
+}
@@ -0,0 +1,83 @@
+/* Arms kernel timers on levels 0, 1 and 2 of the timing wheel
+   (level 2 starts 4096 ticks out), cancels one of them, and checks
+   that the rest fire in deadline order and the cancelled one never
+   fires.  Also checks that a timer re-armed from its own callback
+   for a deadline already past fires on a later tick rather than
+   again in the same one. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define TIMER_CNT 5
+
+static const int64_t delays[TIMER_CNT] = {300, 5, 100, 70, 4100};
+
+static struct timer timers[TIMER_CNT];
+static int fired[TIMER_CNT];
+static int fired_cnt;
+static struct semaphore done;
+
+static struct timer rearm_timer;
+static int64_t rearm_ticks[2];
+static int rearm_cnt;
+static struct semaphore rearmed;
+
+static void
+on_expire (struct timer *timer UNUSED, void *aux)
+{
+  int idx = (int) (intptr_t) aux;
+  fired[fired_cnt++] = idx;
+  sema_up (&done);
+}
+
+static void
+on_rearm_expire (struct timer *timer, void *aux UNUSED)
+{
+  rearm_ticks[rearm_cnt++] = timer_ticks ();
+  if (rearm_cnt == 1)
+    timer_arm (timer, rearm_ticks[0] - 1);
+  else
+    sema_up (&rearmed);
+}
+
+void
+test_alarm_cancel (void)
+{
+  int64_t start;
+  int i;
+
+  sema_init (&done, 0);
+  sema_init (&rearmed, 0);
+  start = timer_ticks ();
+  timer_setup (&rearm_timer, on_rearm_expire, NULL);
+  timer_arm (&rearm_timer, start + 10);
+  for (i = 0; i < TIMER_CNT; i++)
+    {
+      timer_setup (&timers[i], on_expire, (void *) (intptr_t) i);
+      timer_arm (&timers[i], start + delays[i]);
+    }
+
+  if (!timer_cancel (&timers[2]))
+    fail ("pending timer could not be cancelled");
+  if (timer_cancel (&timers[2]))
+    fail ("timer cancelled twice");
+
+  sema_down (&rearmed);
+  if (rearm_ticks[1] <= rearm_ticks[0])
+    fail ("re-armed timer fired twice in tick %lld", rearm_ticks[0]);
+
+  for (i = 0; i < TIMER_CNT - 1; i++)
+    sema_down (&done);
+
+  if (fired_cnt != TIMER_CNT - 1)
+    fail ("%d timers fired, expected %d", fired_cnt, TIMER_CNT - 1);
+  for (i = 0; i < fired_cnt; i++)
+    msg ("timer %d fired", fired[i]);
+  if (timer_elapsed (start) < delays[TIMER_CNT - 1])
+    fail ("timers fired early");
+  pass ();
+}
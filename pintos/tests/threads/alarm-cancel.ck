@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-cancel) begin
+(alarm-cancel) timer 1 fired
+(alarm-cancel) timer 3 fired
+(alarm-cancel) timer 0 fired
+(alarm-cancel) timer 4 fired
+(alarm-cancel) PASS
+(alarm-cancel) end
+EOF
+pass;
@@ -23,6 +23,18 @@ test_alarm_multiple (void)
 {
   test_sleep (5, 7);
 }
+
+/* Same as alarm-multiple, run with -tickless.  The sleepers leave
+   the CPU idle for several ticks at a time, so some tick interrupts
+   must have been suppressed. */
+void
+test_alarm_tickless (void) 
+{
+  ASSERT (timer_tickless);
+  test_sleep (5, 7);
+  if (timer_suppressed_ticks () == 0)
+    fail ("no tick interrupts were suppressed");
+}
 
 /* Information about the test. */
 struct sleep_test 
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::mlfqs;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+my (@actual);
+foreach (@output) {
+    my ($id, $count) = /Thread (\d+) received (\d+) ticks\./ or next;
+    $actual[$id] = $count;
+}
+mlfqs_compare ("thread", "%d", \@actual, [2260, 740], 100, [0, 1, 1],
+	       "Some tick counts were missing or differed from those "
+	       . "expected by more than 100.");
+pass;
@@ -0,0 +1,87 @@
+/* Three reader threads of increasing priority take read access
+   to the same rwlock and block while holding it.  All three must
+   be inside at once: if read access were exclusive, the second
+   reader would never get in and the test would hang.  The main
+   thread then lets them go, highest priority first, and finally
+   takes write access once they have all left. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define READER_CNT 3
+
+struct readers_data
+  {
+    struct rwlock rw;
+    struct semaphore inside;    /* Upped by each reader once in. */
+    struct semaphore go;        /* Lets one reader leave. */
+    struct semaphore done;      /* Upped by each reader once out. */
+  };
+
+struct reader
+  {
+    struct readers_data *data;
+    int id;
+  };
+
+static thread_func reader_thread_func;
+
+void
+test_rwlock_readers (void) 
+{
+  struct readers_data data;
+  struct reader readers[READER_CNT];
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&data.rw);
+  sema_init (&data.inside, 0);
+  sema_init (&data.go, 0);
+  sema_init (&data.done, 0);
+
+  for (i = 0; i < READER_CNT; i++) 
+    {
+      char name[16];
+
+      readers[i].data = &data;
+      readers[i].id = i;
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT + 1 + i, reader_thread_func,
+                     &readers[i]);
+    }
+  for (i = 0; i < READER_CNT; i++)
+    sema_down (&data.inside);
+  msg ("All %d readers hold read access at once.", READER_CNT);
+
+  for (i = 0; i < READER_CNT; i++)
+    sema_up (&data.go);
+  for (i = 0; i < READER_CNT; i++)
+    sema_down (&data.done);
+
+  rwlock_acquire_write (&data.rw);
+  msg ("Main thread acquired write access.");
+  rwlock_release_write (&data.rw);
+}
+
+static void
+reader_thread_func (void *reader_) 
+{
+  struct reader *reader = reader_;
+  struct readers_data *data = reader->data;
+
+  rwlock_acquire_read (&data->rw);
+  msg ("Reader %d acquired read access.", reader->id);
+  sema_up (&data->inside);
+  sema_down (&data->go);
+  rwlock_release_read (&data->rw);
+  msg ("Reader %d released read access.", reader->id);
+  sema_up (&data->done);
+}
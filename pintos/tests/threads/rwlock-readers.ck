@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-readers) begin
+(rwlock-readers) Reader 0 acquired read access.
+(rwlock-readers) Reader 1 acquired read access.
+(rwlock-readers) Reader 2 acquired read access.
+(rwlock-readers) All 3 readers hold read access at once.
+(rwlock-readers) Reader 2 released read access.
+(rwlock-readers) Reader 1 released read access.
+(rwlock-readers) Reader 0 released read access.
+(rwlock-readers) Main thread acquired write access.
+(rwlock-readers) end
+EOF
+pass;
@@ -0,0 +1,69 @@
+/* The main thread takes read access to an rwlock.  A writer of
+   higher priority then asks for write access and must wait for
+   the main thread to leave, donating its priority to it.  A
+   reader of yet higher priority arrives next: with writers
+   preferred it must queue up behind the waiting writer rather
+   than join the main thread, and its donation must reach the
+   main thread through the writer.
+
+   When the main thread releases read access it drops back to
+   its own priority and the writer runs, then the reader. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func writer_thread_func;
+static thread_func reader_thread_func;
+
+void
+test_rwlock_writer (void) 
+{
+  struct rwlock rw;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rw);
+  rwlock_acquire_read (&rw);
+  msg ("Main thread acquired read access.");
+
+  thread_create ("writer", PRI_DEFAULT + 5, writer_thread_func, &rw);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 5, thread_get_priority ());
+
+  thread_create ("reader", PRI_DEFAULT + 7, reader_thread_func, &rw);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 7, thread_get_priority ());
+
+  rwlock_release_read (&rw);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+writer_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_write (rw);
+  msg ("Writer acquired write access.");
+  rwlock_release_write (rw);
+  msg ("Writer finished.");
+}
+
+static void
+reader_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  rwlock_acquire_read (rw);
+  msg ("Reader acquired read access.");
+  rwlock_release_read (rw);
+  msg ("Reader finished.");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-writer) begin
+(rwlock-writer) Main thread acquired read access.
+(rwlock-writer) Main thread should have priority 36.  Actual priority: 36.
+(rwlock-writer) Main thread should have priority 38.  Actual priority: 38.
+(rwlock-writer) Writer acquired write access.
+(rwlock-writer) Reader acquired read access.
+(rwlock-writer) Reader finished.
+(rwlock-writer) Writer finished.
+(rwlock-writer) Main thread should have priority 31.  Actual priority: 31.
+(rwlock-writer) end
+EOF
+pass;
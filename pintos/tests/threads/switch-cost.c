@@ -0,0 +1,81 @@
+/* Measures the cost of a kernel thread switch, first as two threads
+   yielding to each other, then as two threads handing a pair of
+   semaphores back and forth.  The numbers are reported, not
+   checked; the test fails only if a phase does not finish. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/hrtimer.h"
+#include "intrinsic.h"
+
+#define ROUNDS 10000
+
+static struct semaphore ping, pong, done;
+
+static void
+yielder (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < ROUNDS; i++)
+    thread_yield ();
+  sema_up (&done);
+}
+
+static void
+ponger (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < ROUNDS; i++)
+    {
+      sema_down (&ping);
+      sema_up (&pong);
+    }
+  sema_up (&done);
+}
+
+/* Reports CYCLES spent on SWITCHES switches under NAME. */
+static void
+report (const char *name, uint64_t cycles, int switches)
+{
+  msg ("%s: %"PRIu64" cycles, %"PRIu64" ns per switch", name,
+       cycles / switches, hrtimer_cycles_to_ns (cycles) / switches);
+}
+
+void
+test_switch_cost (void)
+{
+  uint64_t start;
+  int i;
+
+  ASSERT (!thread_mlfqs);
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&ping, 0);
+  sema_init (&pong, 0);
+  sema_init (&done, 0);
+
+  /* Each yield hands the CPU to the other thread. */
+  thread_create ("yielder", PRI_DEFAULT, yielder, NULL);
+  start = rdtsc ();
+  for (i = 0; i < ROUNDS; i++)
+    thread_yield ();
+  sema_down (&done);
+  report ("yield", rdtsc () - start, 2 * ROUNDS);
+
+  /* Each round trip blocks and wakes each thread once. */
+  thread_create ("ponger", PRI_DEFAULT, ponger, NULL);
+  start = rdtsc ();
+  for (i = 0; i < ROUNDS; i++)
+    {
+      sema_up (&ping);
+      sema_down (&pong);
+    }
+  sema_down (&done);
+  report ("semaphore", rdtsc () - start, 2 * ROUNDS);
+}
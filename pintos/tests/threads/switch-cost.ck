@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+foreach my $phase ("yield", "semaphore") {
+    grep (/^\(switch-cost\) $phase: \d+ cycles, \d+ ns per switch$/, @output)
+      or fail "missing $phase result\n";
+}
+pass;
@@ -0,0 +1,40 @@
+/* Checks that getrusage() charges a busy loop to user time and a
+   run of system calls to system time, and that no bucket runs
+   backward. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static void
+check_monotonic (const struct rusage *a, const struct rusage *b)
+{
+  if (b->ru_utime < a->ru_utime || b->ru_stime < a->ru_stime
+      || b->ru_ftime < a->ru_ftime || b->ru_iotime < a->ru_iotime)
+    fail ("CPU time went backward");
+}
+
+void
+test_main (void) 
+{
+  struct rusage start, spun, called;
+  volatile unsigned sum = 0;
+  int i;
+
+  CHECK (getrusage (&start) == 0, "getrusage");
+  if (start.ru_utime < 0 || start.ru_stime < 0
+      || start.ru_ftime < 0 || start.ru_iotime < 0)
+    fail ("negative CPU time");
+
+  for (i = 0; i < 20000000; i++)
+    sum += i;
+  CHECK (getrusage (&spun) == 0, "getrusage after busy loop");
+  check_monotonic (&start, &spun);
+  CHECK (spun.ru_utime > start.ru_utime, "user time advanced");
+
+  for (i = 0; i < 20000; i++)
+    filesize (-1);
+  CHECK (getrusage (&called) == 0, "getrusage after system calls");
+  check_monotonic (&spun, &called);
+  CHECK (called.ru_stime > spun.ru_stime, "system time advanced");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(getrusage) begin
+(getrusage) getrusage
+(getrusage) getrusage after busy loop
+(getrusage) user time advanced
+(getrusage) getrusage after system calls
+(getrusage) system time advanced
+(getrusage) end
+getrusage: exit(0)
+EOF
+pass;
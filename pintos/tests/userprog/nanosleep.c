@@ -0,0 +1,36 @@
+/* Checks nanosleep() argument handling, then races two sleeps that
+   are both shorter than a timer tick: a child sleeping 3 ms and the
+   parent sleeping 1 ms each write a byte to a shared pipe, and the
+   parent's byte has to arrive first. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define MS 1000000LL
+
+void
+test_main (void) 
+{
+  char order[3] = "";
+  int fds[2];
+  pid_t pid;
+
+  CHECK (nanosleep (0) == 0, "nanosleep 0 ns");
+  CHECK (nanosleep (-1) == -1, "nanosleep -1 ns fails");
+  CHECK (nanosleep (30 * MS) == 0, "nanosleep 30 ms");
+
+  CHECK (pipe (fds) == 0, "create pipe");
+  if ((pid = fork ("child")) == 0)
+    {
+      nanosleep (3 * MS);
+      write (fds[1], "l", 1);
+      exit (0);
+    }
+  nanosleep (1 * MS);
+  write (fds[1], "e", 1);
+  CHECK (wait (pid) == 0, "wait for child");
+  CHECK (read (fds[0], order, 2) == 2, "read wakeup order");
+  if (order[0] != 'e' || order[1] != 'l')
+    fail ("wakeup order \"%s\", expected \"el\"", order);
+}
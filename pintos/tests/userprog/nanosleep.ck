@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(nanosleep) begin
+(nanosleep) nanosleep 0 ns
+(nanosleep) nanosleep -1 ns fails
+(nanosleep) nanosleep 30 ms
+(nanosleep) create pipe
+(nanosleep) wait for child
+child: exit(0)
+(nanosleep) read wakeup order
+(nanosleep) end
+nanosleep: exit(0)
+EOF
+pass;
@@ -0,0 +1,43 @@
+/* Creates a pipe and forks.  The child writes more than a page of
+   data into the pipe, which has to block until the parent drains it;
+   the parent reads until end of file and checks what arrived. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE 10000
+
+static char sent[SIZE];
+static char got[SIZE + 1];
+
+void
+test_main (void) 
+{
+  int fds[2];
+  size_t ofs = 0;
+  pid_t pid;
+  int n;
+
+  for (n = 0; n < SIZE; n++)
+    sent[n] = n * 7;
+
+  CHECK (pipe (fds) == 0, "create pipe");
+  if ((pid = fork ("child")) == 0)
+    {
+      close (fds[0]);
+      if (write (fds[1], sent, SIZE) != SIZE)
+        fail ("short write to pipe");
+      exit (0);
+    }
+  close (fds[1]);
+
+  while ((n = read (fds[0], got + ofs, sizeof got - ofs)) > 0)
+    ofs += n;
+  if (n < 0 || ofs != SIZE)
+    fail ("read %zu bytes instead of %d", ofs, SIZE);
+  compare_bytes (got, sent, SIZE, 0, "pipe");
+  msg ("read all bytes from the pipe");
+  CHECK (wait (pid) == 0, "wait for child");
+  CHECK (write (fds[0], sent, 1) == -1, "write to read end fails");
+}
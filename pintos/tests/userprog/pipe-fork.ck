@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-fork) begin
+(pipe-fork) create pipe
+child: exit(0)
+(pipe-fork) read all bytes from the pipe
+(pipe-fork) wait for child
+(pipe-fork) write to read end fails
+(pipe-fork) end
+pipe-fork: exit(0)
+EOF
+pass;
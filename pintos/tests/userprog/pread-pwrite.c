@@ -0,0 +1,29 @@
+/* Reads and writes a file at explicit offsets with pread() and
+   pwrite(), and checks that neither moves the file position. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[16];
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  seek (handle, 5);
+
+  CHECK (pread (handle, buf, sizeof buf, 100) == sizeof buf,
+         "pread \"sample.txt\" at offset 100");
+  compare_bytes (buf, sample + 100, sizeof buf, 100, "sample.txt");
+  CHECK (pwrite (handle, "KAIST", 5, 200) == 5,
+         "pwrite \"sample.txt\" at offset 200");
+  CHECK (pread (handle, buf, 5, 200) == 5,
+         "pread \"sample.txt\" at offset 200");
+  compare_bytes (buf, "KAIST", 5, 200, "sample.txt");
+  CHECK (tell (handle) == 5, "file position unchanged");
+  CHECK (pread (handle, buf, sizeof buf, -1) == -1,
+         "pread at negative offset fails");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) open "sample.txt"
+(pread-pwrite) pread "sample.txt" at offset 100
+(pread-pwrite) pwrite "sample.txt" at offset 200
+(pread-pwrite) pread "sample.txt" at offset 200
+(pread-pwrite) file position unchanged
+(pread-pwrite) pread at negative offset fails
+(pread-pwrite) end
+pread-pwrite: exit(0)
+EOF
+pass;
@@ -0,0 +1,39 @@
+/* Writes a file with writev() from several buffers, then reads it
+   back with readv() into a differently split set of buffers. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  char head[7], body[sizeof sample];
+  struct iovec iov[3];
+  int handle;
+
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  iov[0].iov_base = sample;
+  iov[0].iov_len = 10;
+  iov[1].iov_base = sample + 10;
+  iov[1].iov_len = 0;
+  iov[2].iov_base = sample + 10;
+  iov[2].iov_len = size - 10;
+  CHECK (writev (handle, iov, 3) == (int) size, "writev \"test.txt\"");
+  CHECK (tell (handle) == size, "tell \"test.txt\" after writev");
+
+  seek (handle, 0);
+  iov[0].iov_base = head;
+  iov[0].iov_len = sizeof head;
+  iov[1].iov_base = body;
+  iov[1].iov_len = sizeof body;
+  CHECK (readv (handle, iov, 2) == (int) size, "readv \"test.txt\"");
+  compare_bytes (head, sample, sizeof head, 0, "test.txt");
+  compare_bytes (body, sample + sizeof head, size - sizeof head,
+                 sizeof head, "test.txt");
+  CHECK (readv (handle, iov, 0) == -1, "readv with no buffers fails");
+}
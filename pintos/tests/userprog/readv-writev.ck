@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(readv-writev) begin
+(readv-writev) create "test.txt"
+(readv-writev) open "test.txt"
+(readv-writev) writev "test.txt"
+(readv-writev) tell "test.txt" after writev
+(readv-writev) readv "test.txt"
+(readv-writev) readv with no buffers fails
+(readv-writev) end
+readv-writev: exit(0)
+EOF
+pass;
@@ -0,0 +1,27 @@
+/* Copies sample.txt into a new file with sendfile() and checks the
+   copy and both file positions. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  int in, out;
+
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((in = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((out = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  CHECK (sendfile (out, in, size + 100) == (int) size,
+         "sendfile \"sample.txt\" to \"test.txt\"");
+  CHECK (tell (in) == size && tell (out) == size,
+         "both positions advanced");
+  CHECK (sendfile (out, in, 100) == 0, "sendfile at end of file");
+  CHECK (sendfile (in, 0, 100) == -1, "sendfile from stdin fails");
+  close (out);
+  check_file ("test.txt", sample, size);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sendfile) begin
+(sendfile) create "test.txt"
+(sendfile) open "sample.txt"
+(sendfile) open "test.txt"
+(sendfile) sendfile "sample.txt" to "test.txt"
+(sendfile) both positions advanced
+(sendfile) sendfile at end of file
+(sendfile) sendfile from stdin fails
+(sendfile) open "test.txt" for verification
+(sendfile) verified contents of "test.txt"
+(sendfile) close "test.txt"
+(sendfile) end
+sendfile: exit(0)
+EOF
+pass;
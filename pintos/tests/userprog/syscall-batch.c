@@ -0,0 +1,56 @@
+/* Queues several system calls on a batch ring and runs them with a
+   single batch_enter(). */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ENTRIES 4
+
+static uint64_t ring_buf[BATCH_RING_SIZE (ENTRIES) / sizeof (uint64_t) + 1];
+
+static void
+queue (struct batch_ring *ring, uint32_t op, int fd, void *addr,
+       unsigned len, int offset)
+{
+  struct batch_sqe *sqe = &batch_sq (ring)[ring->sq_tail % ENTRIES];
+  sqe->op = op;
+  sqe->fd = fd;
+  sqe->addr = (uint64_t) addr;
+  sqe->len = len;
+  sqe->offset = offset;
+  sqe->user_data = ring->sq_tail;
+  ring->sq_tail++;
+}
+
+void
+test_main (void) 
+{
+  struct batch_ring *ring = (struct batch_ring *) ring_buf;
+  char a[10], b[10];
+  int handle;
+  uint32_t i;
+
+  CHECK (batch_setup (ring, 3) == -1, "batch_setup rejects 3 entries");
+  CHECK (batch_setup (ring, ENTRIES) == 0, "batch_setup");
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  queue (ring, BATCH_READ, handle, a, sizeof a, 0);
+  queue (ring, BATCH_NOP, 0, NULL, 0, 0);
+  queue (ring, BATCH_READ, handle, b, sizeof b, 50);
+  queue (ring, BATCH_CLOSE, handle, NULL, 0, 0);
+  CHECK (batch_enter () == 4, "batch_enter");
+
+  for (i = 0; i < 4; i++)
+    {
+      struct batch_cqe *cqe = &batch_cq (ring)[ring->cq_head++ % ENTRIES];
+      int64_t expected = i == 0 || i == 2 ? 10 : 0;
+      if (cqe->user_data != i || cqe->result != expected)
+        fail ("completion %u: user_data %llu, result %lld", i,
+              (unsigned long long) cqe->user_data, (long long) cqe->result);
+    }
+  compare_bytes (a, sample, sizeof a, 0, "sample.txt");
+  compare_bytes (b, sample + 50, sizeof b, 50, "sample.txt");
+  CHECK (read (handle, a, 1) == -1, "handle closed by the ring");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(syscall-batch) begin
+(syscall-batch) batch_setup rejects 3 entries
+(syscall-batch) batch_setup
+(syscall-batch) open "sample.txt"
+(syscall-batch) batch_enter
+(syscall-batch) handle closed by the ring
+(syscall-batch) end
+syscall-batch: exit(0)
+EOF
+pass;
@@ -0,0 +1,27 @@
+/* Polls a sleeping child with wait_timeout(): a zero timeout and a
+   short one both report it still running, then a long one collects
+   its exit status. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int status = 0;
+  pid_t pid;
+
+  CHECK (wait_timeout (-1, 0, &status) == -1, "wait_timeout on bad pid");
+
+  if ((pid = fork ("child")) == 0)
+    {
+      nanosleep (300 * 1000000LL);
+      exit (81);
+    }
+  CHECK (wait_timeout (pid, 0, &status) == 1, "poll running child");
+  CHECK (wait_timeout (pid, 20, &status) == 1, "wait 20 ms for running child");
+  CHECK (wait_timeout (pid, 10000, &status) == 0, "wait for child to exit");
+  CHECK (status == 81, "child exit status %d", status);
+  CHECK (wait_timeout (pid, 0, &status) == -1, "wait for it again");
+}
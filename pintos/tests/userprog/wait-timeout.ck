@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(wait-timeout) begin
+(wait-timeout) wait_timeout on bad pid
+(wait-timeout) poll running child
+(wait-timeout) wait 20 ms for running child
+child: exit(81)
+(wait-timeout) wait for child to exit
+(wait-timeout) child exit status 81
+(wait-timeout) wait for it again
+(wait-timeout) end
+wait-timeout: exit(0)
+EOF
+pass;
@@ -0,0 +1,42 @@
+/* Checks futex argument handling, then has a parent sleep on a word
+   in a named shared segment until a child, which maps the segment at
+   a different address, sets the word and wakes it. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define PARENT ((char *) 0x10000000)
+#define CHILD ((char *) 0x20000000)
+
+void
+test_main (void) 
+{
+  int private = 0;
+  int *word = (int *) (PARENT + 64);
+  int pid;
+
+  CHECK (futex_wait (&private, 1) == -1, "wait on changed word");
+  CHECK (futex_wake (&private, 1) == 0, "wake with no waiters");
+
+  CHECK (shm_map ("futex-shm", PARENT, PAGE) == PARENT, "map segment");
+  if ((pid = fork ("child")) == 0)
+    {
+      int *child_word;
+
+      if (shm_map ("futex-shm", CHILD, PAGE) != CHILD)
+        fail ("child could not attach segment");
+      child_word = (int *) (CHILD + 64);
+      *child_word = 1;
+      futex_wake (child_word, 1);
+      exit (0);
+    }
+
+  while (*word == 0)
+    futex_wait (word, 0);
+  CHECK (wait (pid) == 0, "wait for child");
+  msg ("woken with word %d", *word);
+  shm_unlink ("futex-shm");
+  shm_unmap (PARENT);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-shm) begin
+(futex-shm) wait on changed word
+(futex-shm) wake with no waiters
+(futex-shm) map segment
+child: exit(0)
+(futex-shm) wait for child
+(futex-shm) woken with word 1
+(futex-shm) end
+futex-shm: exit(0)
+EOF
+pass;
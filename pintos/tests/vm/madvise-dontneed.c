@@ -0,0 +1,42 @@
+/* Drops heap pages with MADV_DONTNEED and checks that they fault
+   back in as zeros, while the same advice leaves the executable's
+   code and initialized data as they were. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+
+static char data[2 * PAGE] __attribute__ ((aligned (PAGE))) =
+  { [0] = 'd', [1] = 'a', [PAGE] = 't', [PAGE + 1] = 'a' };
+
+void
+test_main (void) 
+{
+  char *heap = sbrk (2 * PAGE);
+  uint8_t *text = (uint8_t *) ((uintptr_t) test_main & ~(uintptr_t) (PAGE - 1));
+  uint8_t code[64];
+  int i;
+
+  CHECK (heap != (void *) -1, "sbrk (2 * PAGE)");
+  memset (heap, 'h', 2 * PAGE);
+  CHECK (madvise (heap, 2 * PAGE, MADV_DONTNEED) == 0, "madvise heap");
+  for (i = 0; i < 2 * PAGE; i++)
+    if (heap[i] != 0)
+      fail ("heap byte %d is %d after MADV_DONTNEED", i, heap[i]);
+  msg ("heap reads back as zeros");
+  heap[PAGE] = 'r';
+  CHECK (heap[PAGE] == 'r' && heap[0] == 0, "heap usable after refault");
+
+  data[1] = 'w';
+  CHECK (madvise (data, sizeof data, MADV_DONTNEED) == 0, "madvise data");
+  CHECK (data[0] == 'd' && data[1] == 'w', "data page kept");
+  CHECK (data[PAGE] == 't' && data[PAGE + 1] == 'a', "second data page kept");
+
+  memcpy (code, text, sizeof code);
+  CHECK (madvise (text, PAGE, MADV_DONTNEED) == 0, "madvise code");
+  CHECK (!memcmp (code, text, sizeof code), "code page kept");
+}
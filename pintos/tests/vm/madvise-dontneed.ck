@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(madvise-dontneed) begin
+(madvise-dontneed) sbrk (2 * PAGE)
+(madvise-dontneed) madvise heap
+(madvise-dontneed) heap reads back as zeros
+(madvise-dontneed) heap usable after refault
+(madvise-dontneed) madvise data
+(madvise-dontneed) data page kept
+(madvise-dontneed) second data page kept
+(madvise-dontneed) madvise code
+(madvise-dontneed) code page kept
+(madvise-dontneed) end
+madvise-dontneed: exit(0)
+EOF
+pass;
@@ -0,0 +1,58 @@
+/* Grows and shrinks the heap with sbrk(), then exercises malloc(),
+   realloc() and free() on top of it. */
+
+#include <malloc.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define BLOCKS 200
+
+static char *blocks[BLOCKS];
+
+void
+test_main (void) 
+{
+  char *brk = sbrk (0);
+  char *big, *p;
+  int i;
+
+  CHECK (brk != (void *) -1, "sbrk (0)");
+  CHECK (sbrk (3 * PAGE) == brk, "grow heap by 3 pages");
+  for (i = 0; i < 3 * PAGE; i++)
+    if (brk[i] != 0)
+      fail ("new heap byte %d is not zero", i);
+  brk[PAGE] = 'x';
+  CHECK (sbrk (-3 * PAGE) == brk + 3 * PAGE, "shrink heap back");
+  CHECK (sbrk (0) == brk, "break restored");
+
+  for (i = 0; i < BLOCKS; i++)
+    {
+      size_t size = 1 + (i * 37) % 900;
+      blocks[i] = malloc (size);
+      if (blocks[i] == NULL)
+        fail ("malloc (%zu) failed", size);
+      memset (blocks[i], i, size);
+    }
+  for (i = 0; i < BLOCKS; i += 2)
+    free (blocks[i]);
+  for (i = 1; i < BLOCKS; i += 2)
+    {
+      size_t size = 1 + (i * 37) % 900;
+      for (size_t j = 0; j < size; j++)
+        if (blocks[i][j] != (char) i)
+          fail ("block %d corrupted", i);
+    }
+  msg ("small blocks intact");
+
+  big = malloc (5 * PAGE);
+  memset (big, 'b', 5 * PAGE);
+  p = realloc (big, 9 * PAGE);
+  CHECK (p != NULL && p[5 * PAGE - 1] == 'b', "realloc large block");
+  free (p);
+  p = calloc (3, PAGE);
+  CHECK (p != NULL && p[2 * PAGE] == 0, "calloc after free");
+  free (p);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sbrk-malloc) begin
+(sbrk-malloc) sbrk (0)
+(sbrk-malloc) grow heap by 3 pages
+(sbrk-malloc) shrink heap back
+(sbrk-malloc) break restored
+(sbrk-malloc) small blocks intact
+(sbrk-malloc) realloc large block
+(sbrk-malloc) calloc after free
+(sbrk-malloc) end
+sbrk-malloc: exit(0)
+EOF
+pass;
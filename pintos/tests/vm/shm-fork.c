@@ -0,0 +1,44 @@
+/* Maps an anonymous and a named shared segment, then forks.  The
+   child writes to the inherited anonymous segment and to the named
+   segment, which it attaches at a different address; the parent
+   must see both writes. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE 4096
+#define ANON ((char *) 0x10000000)
+#define NAMED ((char *) 0x20000000)
+#define NAMED_CHILD ((char *) 0x30000000)
+
+void
+test_main (void) 
+{
+  int pid;
+
+  CHECK (shm_map (NULL, ANON, 2 * PAGE) == ANON, "map anonymous segment");
+  CHECK (shm_map ("shm-fork", NAMED, PAGE) == NAMED, "map named segment");
+  ANON[0] = 'p';
+
+  if ((pid = fork ("child")) == 0)
+    {
+      if (ANON[0] != 'p')
+        fail ("child does not see parent's write");
+      ANON[PAGE + 5] = 'a';
+      if (shm_map ("shm-fork", NAMED_CHILD, PAGE) != NAMED_CHILD)
+        fail ("child could not attach named segment");
+      NAMED_CHILD[7] = 'n';
+      exit (0);
+    }
+
+  if (wait (pid) != 0)
+    fail ("child failed");
+  CHECK (ANON[PAGE + 5] == 'a', "anonymous segment shared with child");
+  CHECK (NAMED[7] == 'n', "named segment shared with child");
+  CHECK (shm_unlink ("shm-fork"), "unlink named segment");
+  CHECK (!shm_unlink ("shm-fork"), "unlink it again");
+  CHECK (NAMED[7] == 'n', "segment survives unlink while mapped");
+  shm_unmap (ANON);
+  shm_unmap (NAMED);
+}
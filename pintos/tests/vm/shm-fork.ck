@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(shm-fork) begin
+(shm-fork) map anonymous segment
+(shm-fork) map named segment
+child: exit(0)
+(shm-fork) anonymous segment shared with child
+(shm-fork) named segment shared with child
+(shm-fork) unlink named segment
+(shm-fork) unlink it again
+(shm-fork) segment survives unlink while mapped
+(shm-fork) end
+shm-fork: exit(0)
+EOF
+pass;
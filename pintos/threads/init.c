@@ -11,16 +11,19 @@
 #include "devices/kbd.h"
 #include "devices/input.h"
 #include "devices/serial.h"
+#include "devices/hrtimer.h"
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/ktrace.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -36,6 +39,7 @@
 #include "devices/disk.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
+#include "filesys/inode.h"
 #endif
 
 /* Page-map-level-4 with kernel mappings only. */
@@ -86,6 +90,7 @@ main (void) {
 	mem_end = palloc_init ();
 	malloc_init ();
 	paging_init (mem_end);
+	ktrace_init ();
 
 #ifdef USERPROG
 	tss_init ();
@@ -95,6 +100,7 @@ main (void) {
 	/* Initialize interrupt handlers. */
 	intr_init ();
 	timer_init ();
+	hrtimer_init ();
 	kbd_init ();
 	input_init ();
 #ifdef USERPROG
@@ -103,8 +109,10 @@ main (void) {
 #endif
 	/* Start thread scheduler and enable interrupts. */
 	thread_start ();
+	workqueue_init ();
 	serial_init_queue ();
 	timer_calibrate ();
+	hrtimer_calibrate ();
 
 #ifdef FILESYS
 	/* Initialize file system. */
@@ -221,15 +229,28 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-cfs")) {
+			thread_cfs = true;
+			if (value != NULL && (cfs_granularity = atoi (value)) < 1)
+				PANIC ("-cfs granularity must be at least 1 tick");
+		}
+		else if (!strcmp (name, "-tickless"))
+			timer_tickless = true;
+		else if (!strcmp (name, "-ktrace"))
+			ktrace_enabled = true;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
+		else if (!strcmp (name, "-rusage"))
+			process_rusage = true;
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
 	}
+	if (thread_mlfqs && thread_cfs)
+		PANIC ("-mlfqs and -cfs cannot be used together");
 
 	return argv;
 }
@@ -326,8 +347,12 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -cfs[=GRAN]        Use fair-share scheduler, GRAN ticks minimum slice.\n"
+			"  -tickless          Stop the periodic timer while idle.\n"
+			"  -ktrace            Record kernel events, dump them at power off.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+			"  -rusage            Report CPU usage when a process exits.\n"
 #endif
 			);
 	power_off ();
@@ -343,6 +368,7 @@ power_off (void) {
 #endif
 
 	print_stats ();
+	ktrace_dump ();
 
 	printf ("Powering off...\n");
 	outw (0x604, 0x2000);               /* Poweroff command for qemu */
@@ -356,6 +382,7 @@ print_stats (void) {
 	thread_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
+	inode_print_stats ();
 #endif
 	console_print_stats ();
 	kbd_print_stats ();
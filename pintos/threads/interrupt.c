@@ -331,6 +331,7 @@ pic_end_of_interrupt (int irq) {
 void
 intr_handler (struct intr_frame *frame) {
 	bool external;
+	bool from_user = (frame->cs & 3) == 3;
 	intr_handler_func *handler;
 
 	/* External interrupts are special.
@@ -344,8 +345,18 @@ intr_handler (struct intr_frame *frame) {
 
 		in_external_intr = true;
 		yield_on_return = false;
+
+		/* Any device interrupt ends tickless idle, so its handler
+		   sees an up-to-date tick count and a ticking timer. */
+		if (frame->vec_no != 0x20)
+			timer_idle_exit ();
 	}
 
+	/* Time spent handling an interrupt taken in user mode is system
+	   time. */
+	if (from_user)
+		thread_acct_enter (ACCT_SYS);
+
 	/* Invoke the interrupt's handler. */
 	handler = intr_handlers[frame->vec_no];
 	if (handler != NULL)
@@ -372,6 +383,9 @@ intr_handler (struct intr_frame *frame) {
 		if (yield_on_return)
 			thread_yield ();
 	}
+
+	if (from_user)
+		thread_acct_enter (ACCT_USER);
 }
 
 /* Dumps interrupt frame F to the console, for debugging. */
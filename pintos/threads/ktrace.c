@@ -0,0 +1,108 @@
+#include "threads/ktrace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/hrtimer.h"
+#include "devices/serial.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/sched.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+/* Pages of ring, and the records they hold. */
+#define KTRACE_PAGES 16
+#define KTRACE_RECS (KTRACE_PAGES * PGSIZE / sizeof (struct ktrace_rec))
+
+/* The ring.  Only written with interrupts off.  HEAD counts every record ever written, so the ring holds the last
+   min(HEAD, KTRACE_RECS) of them. */
+struct ktrace_ring {
+	struct ktrace_rec *recs;    /* NULL until ktrace_init(). */
+	uint64_t head;
+};
+
+/* Set by "-ktrace". */
+bool ktrace_enabled;
+
+static struct ktrace_ring ring;
+static bool dumping;            /* Recording paused by ktrace_dump(). */
+
+static void dump_line (const char *format, ...) PRINTF_FORMAT (1, 2);
+
+/* Allocates the ring if tracing was asked for.  Events before this
+   are dropped. */
+void
+ktrace_init (void) {
+	if (!ktrace_enabled)
+		return;
+	ring.recs = palloc_get_multiple (PAL_ZERO, KTRACE_PAGES);
+	if (ring.recs == NULL)
+		printf ("ktrace: no memory for the ring\n");
+	else
+		printf ("ktrace: %zu records\n", KTRACE_RECS);
+}
+
+/* Records an event.  Use KTRACE_EVENT() rather
+   than calling this directly, so the call compiles out. */
+void
+ktrace_log (enum ktrace_type type, uint64_t arg, unsigned aux) {
+	enum intr_level old_level = intr_disable ();
+	struct ktrace_ring *r = &ring;
+
+	if (r->recs != NULL && !dumping) {
+		struct ktrace_rec *e = &r->recs[r->head++ % KTRACE_RECS];
+		e->tsc = rdtsc ();
+		e->arg = arg;
+		e->tid = sched.curr != NULL ? sched.curr->tid : 0;
+		e->aux = aux;
+		e->type = type;
+		e->pad = 0;
+	}
+	intr_set_level (old_level);
+}
+
+/* Writes the ring to the serial port, oldest record first,
+   bracketed by "KTRACE BEGIN" and "KTRACE END" lines.  Recording
+   pauses meanwhile.  The serial port is used directly, so the dump
+   does not scroll through the VGA console. */
+void
+ktrace_dump (void) {
+	struct ktrace_ring *r = &ring;
+	uint64_t first = 0;
+
+	if (!ktrace_enabled || dumping)
+		return;
+	dumping = true;
+	barrier ();
+
+	dump_line ("KTRACE BEGIN hz=%"PRIu64"\n", hrtimer_tsc_hz ());
+	if (r->recs != NULL) {
+		first = r->head > KTRACE_RECS ? r->head - KTRACE_RECS : 0;
+		for (uint64_t n = first; n < r->head; n++) {
+			const struct ktrace_rec *e = &r->recs[n % KTRACE_RECS];
+			dump_line ("KT %"PRIx64" %u %d %"PRIx64" %u\n",
+					e->tsc, e->type, e->tid, e->arg, e->aux);
+		}
+	}
+	dump_line ("KTRACE END dropped=%"PRIu64"\n", first);
+	serial_flush ();
+
+	barrier ();
+	dumping = false;
+}
+
+/* Formats a line of at most 80 bytes and sends it to the serial
+   port. */
+static void
+dump_line (const char *format, ...) {
+	char buf[80];
+	va_list args;
+
+	va_start (args, format);
+	vsnprintf (buf, sizeof buf, format, args);
+	va_end (args);
+	for (const char *p = buf; *p != '\0'; p++)
+		serial_putc (*p);
+}
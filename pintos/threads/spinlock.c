@@ -0,0 +1,43 @@
+#include "threads/spinlock.h"
+#include <debug.h>
+#include <stddef.h>
+
+/* Initializes LOCK as released.  NAME is kept for debugging. */
+void
+spinlock_init (struct spinlock *lock, const char *name) {
+	ASSERT (lock != NULL);
+
+	lock->held = false;
+	lock->name = name;
+}
+
+/* Disables interrupts and marks LOCK held.  Returns the previous
+   interrupt level for spinlock_release().  Nothing else can run
+   while interrupts are off, so LOCK is never found held here unless
+   the caller already holds it, which is a bug. */
+enum intr_level
+spinlock_acquire (struct spinlock *lock) {
+	enum intr_level old_level = intr_disable ();
+
+	ASSERT (!lock->held);
+	lock->held = true;
+	return old_level;
+}
+
+/* Releases LOCK, which must be held, and restores interrupt level
+   OLD_LEVEL. */
+void
+spinlock_release (struct spinlock *lock, enum intr_level old_level) {
+	ASSERT (spinlock_held (lock));
+
+	lock->held = false;
+	intr_set_level (old_level);
+}
+
+/* Returns true if LOCK is held.  Since it is only held with
+   interrupts off, that means held by the running thread whenever
+   interrupts are on or the caller took it itself. */
+bool
+spinlock_held (const struct spinlock *lock) {
+	return lock->held;
+}
@@ -29,7 +29,9 @@
 #include "threads/synch.h"
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/interrupt.h"
+#include "threads/ktrace.h"
 #include "threads/thread.h"
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
@@ -45,6 +47,7 @@ void
 sema_init (struct semaphore *sema, unsigned value) {
 	ASSERT (sema != NULL);
 
+	spinlock_init (&sema->guard, "semaphore");
 	sema->value = value;
 	list_init (&sema->waiters);
 }
@@ -64,13 +67,72 @@ sema_down (struct semaphore *sema) {
 	ASSERT (sema != NULL);
 	ASSERT (!intr_context ());
 
-	old_level = intr_disable ();
+	old_level = spinlock_acquire (&sema->guard);
 	while (sema->value == 0) {
 		list_push_back (&sema->waiters, &thread_current ()->elem_default);
-		thread_block ();
+		thread_block_on (&sema->guard);
 	}
 	sema->value--;
-	intr_set_level (old_level);
+	spinlock_release (&sema->guard, old_level);
+}
+
+/* A thread in sema_down_timeout(), for the timer callback. */
+struct sema_timeout {
+	struct semaphore *sema;
+	struct thread *thread;
+	bool expired;               /* Set by sema_timeout_expire(). */
+};
+
+/* Timer callback for sema_down_timeout().  A waiter that is still
+   blocked under the guard is still on the semaphore's queue, since
+   sema_up() unblocks whoever it dequeues. */
+static void
+sema_timeout_expire (struct timer *timer UNUSED, void *aux) {
+	struct sema_timeout *w = aux;
+	enum intr_level old_level = spinlock_acquire (&w->sema->guard);
+
+	w->expired = true;
+	if (w->thread->status == THREAD_BLOCKED) {
+		list_remove (&w->thread->elem_default);
+		thread_unblock (w->thread);
+	}
+	spinlock_release (&w->sema->guard, old_level);
+}
+
+/* Like sema_down(), but gives up once TICKS timer ticks have
+   passed.  Returns true if SEMA was decremented, false on timeout.
+   With TICKS <= 0 this is sema_try_down().
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool
+sema_down_timeout (struct semaphore *sema, int64_t ticks) {
+	struct sema_timeout w;
+	struct timer timer;
+	enum intr_level old_level;
+	bool success;
+
+	ASSERT (sema != NULL);
+	ASSERT (!intr_context ());
+
+	old_level = spinlock_acquire (&sema->guard);
+	if (sema->value == 0 && ticks > 0) {
+		w.sema = sema;
+		w.thread = thread_current ();
+		w.expired = false;
+		timer_setup (&timer, sema_timeout_expire, &w);
+		timer_arm (&timer, timer_ticks () + ticks);
+		while (sema->value == 0 && !w.expired) {
+			list_push_back (&sema->waiters, &thread_current ()->elem_default);
+			thread_block_on (&sema->guard);
+		}
+		timer_cancel (&timer);
+	}
+	success = sema->value > 0;
+	if (success)
+		sema->value--;
+	spinlock_release (&sema->guard, old_level);
+	return success;
 }
 
 /* Down or "P" operation on a semaphore, but only if the
@@ -85,7 +147,7 @@ sema_try_down (struct semaphore *sema) {
 
 	ASSERT (sema != NULL);
 
-	old_level = intr_disable ();
+	old_level = spinlock_acquire (&sema->guard);
 	if (sema->value > 0)
 	{
 		sema->value--;
@@ -93,7 +155,7 @@ sema_try_down (struct semaphore *sema) {
 	}
 	else
 		success = false;
-	intr_set_level (old_level);
+	spinlock_release (&sema->guard, old_level);
 
 	return success;
 }
@@ -108,7 +170,7 @@ sema_up (struct semaphore *sema) {
 
 	ASSERT (sema != NULL);
 
-	old_level = intr_disable ();
+	old_level = spinlock_acquire (&sema->guard);
 	if (!list_empty (&sema->waiters)) {
 		/* 🔥 edward
 		remove top thread from the waiters
@@ -119,8 +181,8 @@ sema_up (struct semaphore *sema) {
 		thread_unblock(list_entry (t, struct thread, elem_default));
 	}
 	sema->value++;
+	spinlock_release (&sema->guard, old_level);
 	check_preemption();
-	intr_set_level (old_level);
 }
 
 static void sema_test_helper (void *sema_);
@@ -179,6 +241,7 @@ lock_init (struct lock *lock) {
 
 	lock->holder = NULL;
 	sema_init (&lock->semaphore, 1);
+	pheap_init (&lock->donors, thread_donor_less, NULL);
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -199,23 +262,19 @@ lock_acquire (struct lock *lock) {
 	ASSERT (!intr_context ());
 	ASSERT (!lock_held_by_current_thread (lock));
 
-	struct thread *curr = thread_current ();
-	if (!thread_mlfqs && lock->holder != NULL) {
+	struct thread *holder = lock->holder;
+	if (holder != NULL) {
 		/* 🔥 edward
 		when lock is already occupied by another thread
-		donate priority to the holder
-		therefore, holder has to refresh its priority
-		then, we have to look for possibility for extra nested donation
+		donate priority to the holder, and down the chain of holders
 		*/
-		curr->waiting_for = lock;
-		list_push_back (&lock->holder->donators, &curr->elem_donator);
-		thread_refresh_priority (lock->holder);
-		thread_propagate_donation (lock->holder);
-	}
-
-	sema_down (&lock->semaphore);
-	curr->waiting_for = NULL; /* 🔥 edward: got the lock */
-	lock->holder = curr;
+		KTRACE_EVENT (KT_LOCK_WAIT, lock, holder->tid);
+		thread_lock_wait (lock);
+		sema_down (&lock->semaphore);
+		KTRACE_EVENT (KT_LOCK_GOT, lock, 0);
+	} else
+		sema_down (&lock->semaphore);
+	thread_lock_acquired (lock); /* 🔥 edward: got the lock */
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -233,7 +292,7 @@ lock_try_acquire (struct lock *lock) {
 
 	success = sema_try_down (&lock->semaphore);
 	if (success)
-		lock->holder = thread_current ();
+		thread_lock_acquired (lock);
 	return success;
 }
 
@@ -248,12 +307,7 @@ lock_release (struct lock *lock) {
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if (!thread_mlfqs) {
-		thread_remove_lock_donations (lock);
-		thread_refresh_priority (thread_current ());
-	}
-
-	lock->holder = NULL;
+	thread_lock_released (lock);
 	sema_up (&lock->semaphore);
 	check_preemption(); /* 🔥 edward: one waiter can possibly can take over the control */
 }
@@ -268,6 +322,134 @@ lock_held_by_current_thread (const struct lock *lock) {
 	return lock->holder == thread_current ();
 }
 
+/* Initializes RWLOCK.  A readers-writer lock may be held by any
+   number of readers at once, or by a single writer.
+
+   Writers are preferred: a writer first takes RWLOCK->gate, which
+   every reader must pass through, and then waits for the readers
+   already inside to drain.  New readers therefore queue up behind a
+   waiting writer instead of starving it.  Because the gate is an
+   ordinary lock, readers and writers blocked behind a writer donate
+   their priority to it through the usual donation machinery, and a
+   writer waiting for the readers to drain donates to each of them
+   (see thread_drain_wait()).
+
+   Read access is not recursive: a thread that already holds read
+   access and asks for it again can deadlock against a waiting
+   writer. */
+void
+rwlock_init (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	lock_init (&rw->gate);
+	sema_init (&rw->drained, 0);
+	spinlock_init (&rw->guard, "rwlock");
+	rw->readers = 0;
+	rw->writer_waiting = false;
+	list_init (&rw->read_holds);
+	rw->drainer = NULL;
+	rw->read_acquires = rw->read_contended = 0;
+	rw->write_acquires = rw->write_contended = 0;
+}
+
+/* Acquires RW for reading, sleeping while a writer holds or waits
+   for it.  This function may sleep, so it must not be called within
+   an interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw) {
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+
+	if (rw->gate.holder != NULL)
+		rw->read_contended++;
+	lock_acquire (&rw->gate);
+	old_level = spinlock_acquire (&rw->guard);
+	rw->readers++;
+	rw->read_acquires++;
+	spinlock_release (&rw->guard, old_level);
+	/* edward: still behind the gate, so no writer is draining yet */
+	thread_read_acquired (rw);
+	lock_release (&rw->gate);
+}
+
+/* Releases read access to RW.  The last reader out wakes a writer
+   waiting for the readers to drain. */
+void
+rwlock_release_read (struct rwlock *rw) {
+	enum intr_level old_level;
+	bool wake;
+
+	ASSERT (rw != NULL);
+
+	thread_read_released (rw);
+	old_level = spinlock_acquire (&rw->guard);
+	ASSERT (rw->readers > 0);
+	wake = --rw->readers == 0 && rw->writer_waiting;
+	if (wake)
+		rw->writer_waiting = false;
+	spinlock_release (&rw->guard, old_level);
+	if (wake)
+		sema_up (&rw->drained);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds it
+   in either mode.  This function may sleep, so it must not be
+   called within an interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) {
+	enum intr_level old_level;
+	bool wait;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+
+	bool contended = rw->gate.holder != NULL || rw->readers > 0;
+	lock_acquire (&rw->gate);
+
+	/* edward: from here on no new reader gets past the gate */
+	old_level = spinlock_acquire (&rw->guard);
+	wait = rw->readers > 0;
+	rw->writer_waiting = wait;
+	spinlock_release (&rw->guard, old_level);
+	if (wait) {
+		thread_drain_wait (rw);
+		sema_down (&rw->drained);
+		thread_drain_done (rw);
+	}
+
+	rw->write_acquires++;
+	if (contended)
+		rw->write_contended++;
+}
+
+/* Releases write access to RW, which must be held by the current
+   thread. */
+void
+rwlock_release_write (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+	ASSERT (rwlock_held_for_write (rw));
+
+	lock_release (&rw->gate);
+}
+
+/* Returns true if the current thread holds RW for writing. */
+bool
+rwlock_held_for_write (const struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	return lock_held_by_current_thread (&rw->gate) && rw->readers == 0;
+}
+
+/* Prints RW's contention statistics, labelled NAME. */
+void
+rwlock_print_stats (const struct rwlock *rw, const char *name) {
+	printf ("%s: %llu reads (%llu contended), %llu writes (%llu contended)\n",
+			name, rw->read_acquires, rw->read_contended,
+			rw->write_acquires, rw->write_contended);
+}
+
 /* One semaphore in a list. */
 struct semaphore_elem {
 	struct list_elem elem;              /* List element. */
@@ -322,6 +504,34 @@ cond_wait (struct condition *cond, struct lock *lock) {
 	lock_acquire (lock);
 }
 
+/* Like cond_wait(), but gives up once TICKS timer ticks have passed.
+   LOCK is reacquired either way.  Returns true if COND was signaled,
+   false on timeout. */
+bool
+cond_wait_timeout (struct condition *cond, struct lock *lock, int64_t ticks) {
+	struct semaphore_elem waiter;
+
+	ASSERT (cond != NULL);
+	ASSERT (lock != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (lock_held_by_current_thread (lock));
+
+	sema_init (&waiter.semaphore, 0);
+	list_push_back (&cond->waiters, &waiter.elem);
+	lock_release (lock);
+	bool signaled = sema_down_timeout (&waiter.semaphore, ticks);
+	lock_acquire (lock);
+
+	/* edward: cond_signal() dequeues and ups under LOCK, so with LOCK
+	   back a signal that raced the timeout shows in the semaphore, and
+	   otherwise we are still queued. */
+	if (!signaled && !sema_try_down (&waiter.semaphore)) {
+		list_remove (&waiter.elem);
+		return false;
+	}
+	return true;
+}
+
 /* If any threads are waiting on COND (protected by LOCK), then
    this function signals one of them to wake up from its wait.
    LOCK must be held before calling this function.
@@ -5,13 +5,19 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <rusage.h>
+#include "devices/hrtimer.h"
 #include "devices/timer.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
+#include "threads/ktrace.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/sched.h"
+#include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -26,14 +32,18 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
-static struct list sleep_list;
-static struct list integrated; /* edward: contains all the threads regardless of their type(ready, sleep) */
+/* Scheduler state (see sched.h).  The run queue holds the processes
+   in THREAD_READY state, that is, processes that are ready to run but
+   not actually running: one FIFO per priority level, with an occupancy
+   bitmap so the highest ready priority is a single bsr. */
+#define READY_QUEUES (PRI_MAX + 1)
+struct sched sched;
 
-/* Idle thread. */
-static struct thread *idle_thread;
+/* Most dead thread pages the scheduler keeps for reuse by thread_create()
+   before handing them back to the page allocator. */
+#define TCB_CACHE_MAX 16
+
+static struct list integrated; /* edward: contains all the threads regardless of their type(ready, blocked) */
 
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
@@ -41,18 +51,11 @@ static struct thread *initial_thread;
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
-/* Thread destruction requests */
-static struct list destruction_req;
-
-/* Statistics. */
-static long long idle_ticks;    /* # of timer ticks spent idle. */
-static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
-static long long user_ticks;    /* # of timer ticks in user programs. */
+/* Guards priority donation state; see thread_donor_less(). */
+static struct spinlock donation_lock;
 
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
-static unsigned thread_ticks;   /* # of timer ticks since last yield. */
-#define DONATION_MAX_DEPTH 8
 #define FP_SHIFT 14
 #define FP_F (1 << FP_SHIFT)
 
@@ -61,6 +64,12 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler instead; see cfs_tick().
+   Controlled by kernel command-line option "-cfs".  A thread runs at
+   least CFS_GRANULARITY ticks before another may preempt it. */
+bool thread_cfs;
+int cfs_granularity = 2;
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -69,12 +78,36 @@ static void init_thread (struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule (void);
 static tid_t allocate_tid (void);
+static void sched_init (void);
+static struct thread *tcb_alloc (void);
+static void tcb_free (struct thread *);
+static void acct_switch (struct thread *prev, struct thread *next);
+static void rq_add (struct thread *);
+static void rq_remove (struct thread *);
+static void ready_push (struct thread *);
+static struct thread *ready_pop (void);
+static int ready_top_priority (void);
+static void thread_requeue (struct thread *, int priority);
+static void donation_refresh (struct thread *);
+static void donation_propagate (struct thread *);
+static void drain_propagate (struct rwlock *);
+static bool held_lock_less (const struct pheap_elem *, const struct pheap_elem *, void *);
+static bool cfs_less (const struct pheap_elem *, const struct pheap_elem *, void *);
+static struct thread *cfs_first (void);
+static void cfs_tick (struct thread *);
+static void cfs_place (struct thread *);
+static bool cfs_preempts (const struct thread *);
 static void mlfqs_tick (void);
 static void mlfqs_update_load_avg (void);
 static int mlfqs_ready_threads (void);
 static void mlfqs_update_priority (struct thread *t);
-static void mlfqs_update_priority_all (void);
-static void mlfqs_update_recent_cpu_all (void);
+static void mlfqs_close_second (void);
+static void mlfqs_decay_ready (void *aux);
+static bool mlfqs_catch_up (struct thread *t);
+static void mlfqs_stamp (struct thread *t);
+static void decay_advance (int coeff);
+static int64_t decay_ratio (const struct decay_mark *, const struct decay_mark *);
+static int mlfqs_priority (const struct thread *t);
 static inline int int_to_fp (int);
 static inline int fp_add (int, int);
 static inline int fp_add_int (int, int);
@@ -102,6 +135,36 @@ static uint64_t gdt[3] = { 0, 0x00af9a000000ffff, 0x00cf92000000ffff };
 static int load_avg;
 static int64_t mlfqs_ticks;
 
+/* edward
+Seconds elapsed under MLFQS, and running totals of the recent_cpu decay
+that let a thread fold in any number of missed seconds in O(1).  Second
+e closes with recent_cpu = c_e * recent_cpu + nice, where c_e is
+2*load_avg/(2*load_avg+1).  Since the last reset, DECAY_NOW holds
+
+  P = c_1 * c_2 * ... * c_e, as a 32-bit mantissa and binary exponent,
+      because it heads to zero under any load, and
+  S = 1 + c_e + c_e * c_(e-1) + ..., in Q20, so S_e = c_e * S_(e-1) + 1.
+
+A thread that last caught up at mark M has, with A = P / M.P,
+
+  recent_cpu = A * recent_cpu + nice * (S - A * M.S).
+
+A second with c = 0 (load_avg 0) sets every recent_cpu to nice, so it
+restarts the totals from DECAY_RESET; a thread stamped before
+DECAY_RESET_EPOCH starts from nice at that mark.  Blocked threads are
+not touched by the per-second sweep; they catch up when woken
+(mlfqs_catch_up).
+*/
+#define DECAY_S_ONE (1 << 20)       /* 1 in a mark's S. */
+#define DECAY_A_ONE (1LL << 30)     /* 1 in a ratio of marks' P. */
+static int64_t mlfqs_epoch;
+static int64_t decay_reset_epoch;
+static struct decay_mark decay_now;
+static const struct decay_mark decay_reset = { 1u << 31, -31, DECAY_S_ONE };
+
+/* Runs mlfqs_decay_ready() on the worker once a second. */
+static struct work mlfqs_work;
+
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
    general and it is possible in this case only because loader.S
@@ -134,19 +197,23 @@ thread_init (void) {
 	lgdt (&gdt_ds);
 
 	/* Init the globla thread context */
+	spinlock_init (&donation_lock, "donation");
 	lock_init (&tid_lock);
-	list_init (&ready_list);
-	list_init (&sleep_list);
+	work_init (&mlfqs_work, mlfqs_decay_ready, NULL);
+	sched_init ();
 	list_init (&integrated);
-	list_init (&destruction_req);
 	load_avg = 0;
 	mlfqs_ticks = 0;
+	mlfqs_epoch = 0;
+	decay_reset_epoch = 0;
+	decay_now = (struct decay_mark) { 1u << 31, -31, 0 };
 
 	/* Set up a thread structure for the running thread. */
 	initial_thread = running_thread ();
 	init_thread (initial_thread, "main", PRI_DEFAULT);
 	initial_thread->status = THREAD_RUNNING;
 	initial_thread->tid = allocate_tid ();
+	sched.curr = initial_thread;
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -172,17 +239,20 @@ thread_tick (void) {
 	struct thread *t = thread_current ();
 
 	/* Update statistics. */
-	if (t == idle_thread)
-		idle_ticks++;
+	if (t->is_idle)
+		sched.idle_ticks++;
 #ifdef USERPROG
 	else if (t->pml4 != NULL)
-		user_ticks++;
+		sched.user_ticks++;
 #endif
 	else
-		kernel_ticks++;
+		sched.kernel_ticks++;
 
 	/* Enforce preemption. */
-	if (++thread_ticks >= TIME_SLICE)
+	sched.thread_ticks++;
+	if (thread_cfs)
+		cfs_tick (t);
+	else if (sched.thread_ticks >= TIME_SLICE)
 		intr_yield_on_return ();
 
 	if (thread_mlfqs)
@@ -193,7 +263,13 @@ thread_tick (void) {
 void
 thread_print_stats (void) {
 	printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
-			idle_ticks, kernel_ticks, user_ticks);
+			sched.idle_ticks, sched.kernel_ticks, sched.user_ticks);
+	if (sched.creates > 0)
+		printf ("Thread: %lld created (%lld from cache), %llu cycles each; "
+				"%lld exited, %llu cycles each\n",
+				sched.creates, sched.create_hits,
+				sched.create_cycles / sched.creates, sched.exits,
+				sched.exits > 0 ? sched.exit_cycles / sched.exits : 0);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -215,36 +291,43 @@ tid_t
 thread_create (const char *name, int priority, thread_func *function, void *aux) {
 	struct thread *t;
 	tid_t tid;
+	uint64_t start = rdtsc ();
+	enum intr_level old_level;
 
 	ASSERT (function != NULL);
 
 	/* Allocate thread. */
-	t = palloc_get_page (PAL_ZERO); /* edward: Thread gets page */
+	t = tcb_alloc (); /* edward: Thread gets page */
 	if (t == NULL)
 		return TID_ERROR;
 
 	/* Initialize thread. */
 	init_thread (t, name, priority);
+	t->is_idle = function == idle;
 	tid = t->tid = allocate_tid ();
 	if (thread_mlfqs) {
 		t->nice = thread_current ()->nice;
 		t->recent_cpu = 0;
 		mlfqs_update_priority (t);
-	}
+	} else if (thread_cfs)
+		t->nice = thread_current ()->nice;
 
-	/* Call the kernel_thread if it scheduled.
-	 * Note) rdi is 1st argument, and rsi is 2nd argument. */
-	t->tf.rip = (uintptr_t) kernel_thread;
-	t->tf.R.rdi = (uint64_t) function;
-	t->tf.R.rsi = (uint64_t) aux;
-	t->tf.ds = SEL_KDSEG;
-	t->tf.es = SEL_KDSEG;
-	t->tf.ss = SEL_KDSEG;
-	t->tf.cs = SEL_KCSEG;
-	t->tf.eflags = FLAG_IF;
+	/* The first switch to T returns into switch_entry(), which
+	   calls kernel_thread (FUNCTION, AUX) on top of its stack. */
+	struct switch_frame *sf = (struct switch_frame *) ((uint8_t *) t + PGSIZE) - 1;
+	memset (sf, 0, sizeof *sf);
+	sf->rbx = (uint64_t) kernel_thread;
+	sf->r12 = (uint64_t) function;
+	sf->r13 = (uint64_t) aux;
+	sf->rip = switch_entry;
+	t->ksp = (uint64_t) sf;
 
 	/* Add to run queue. */
+	old_level = intr_disable ();
+	sched.creates++;
+	sched.create_cycles += rdtsc () - start;
 	thread_unblock (t);
+	intr_set_level (old_level);
 	check_preemption();
 	return tid;
 }
@@ -266,6 +349,22 @@ thread_block (void) {
 	schedule ();
 }
 
+/* edward
+Blocks the current thread and drops GUARD, a spinlock protecting the
+wait queue the caller just joined, in one step: a waker that takes
+GUARD next already sees us as blocked.  GUARD is held again
+when this returns.  Interrupts must be off.
+*/
+void
+thread_block_on (struct spinlock *guard) {
+	ASSERT (!intr_context ());
+	ASSERT (intr_get_level () == INTR_OFF);
+	thread_current ()->status = THREAD_BLOCKED;
+	spinlock_release (guard, INTR_OFF);
+	schedule ();
+	spinlock_acquire (guard);
+}
+
 bool thread_cmp_priority_desc (const struct list_elem *a, const struct list_elem *b, void *aux UNUSED) {
   const struct thread *ta = list_entry (a, struct thread, elem_default);
   const struct thread *tb = list_entry (b, struct thread, elem_default);
@@ -297,7 +396,12 @@ thread_unblock (struct thread *t) {
 
 	old_level = intr_disable ();
 	ASSERT (t->status == THREAD_BLOCKED);
-	list_insert_ordered (&ready_list, &t->elem_default, thread_cmp_priority_desc, NULL);
+	if (thread_mlfqs && mlfqs_catch_up (t))
+		mlfqs_update_priority (t);
+	if (thread_cfs)
+		cfs_place (t);
+	KTRACE_EVENT (KT_WAKEUP, t->tid, t->priority);
+	ready_push (t);
 	t->status = THREAD_READY;
 	intr_set_level (old_level);
 }
@@ -337,6 +441,7 @@ thread_tid (void) {
 void
 thread_exit (void) {
 	ASSERT (!intr_context ());
+	thread_current ()->exit_start = rdtsc ();
 	list_remove (&thread_current ()->elem_integrated); /* 🔥 destroying elem_integrated (thread struct member) */
 
 #ifdef USERPROG
@@ -344,12 +449,61 @@ thread_exit (void) {
 #endif
 
 	/* Just set our status to dying and schedule another process.
-	   We will be destroyed during the call to schedule_tail(). */
+	   schedule() puts us on sched.destruction_req, and the next
+	   do_schedule() frees our page once we are no longer running. */
 	intr_disable ();
 	do_schedule (THREAD_DYING);
 	NOT_REACHED ();
 }
 
+/* edward
+Charges the running thread's CPU time so far to its current bucket and
+starts charging to STATE instead.  Returns the previous bucket, so a
+caller can put it back on the way out.
+*/
+enum cpu_acct
+thread_acct_enter (enum cpu_acct state) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level = intr_disable ();
+	enum cpu_acct prev = curr->acct_state;
+	uint64_t now = rdtsc ();
+
+	curr->acct[prev] += now - curr->acct_stamp;
+	curr->acct_stamp = now;
+	curr->acct_state = state;
+	intr_set_level (old_level);
+	return prev;
+}
+
+/* Fills in USAGE with the running thread's CPU time so far. */
+void
+thread_get_rusage (struct rusage *usage) {
+	struct thread *curr = thread_current ();
+	enum cpu_acct state = thread_acct_enter (ACCT_SYS);
+
+	usage->ru_utime = hrtimer_cycles_to_ns (curr->acct[ACCT_USER]);
+	usage->ru_stime = hrtimer_cycles_to_ns (curr->acct[ACCT_SYS]);
+	usage->ru_ftime = hrtimer_cycles_to_ns (curr->acct[ACCT_FAULT]);
+	usage->ru_iotime = hrtimer_cycles_to_ns (curr->acct[ACCT_IOWAIT]);
+	thread_acct_enter (state);
+}
+
+/* edward
+Context switch from PREV to NEXT.  Time off the CPU is charged to no
+bucket, except ACCT_IOWAIT, whose clock keeps running while blocked.
+*/
+static void
+acct_switch (struct thread *prev, struct thread *next) {
+	uint64_t now = rdtsc ();
+
+	if (prev->acct_state != ACCT_IOWAIT) {
+		prev->acct[prev->acct_state] += now - prev->acct_stamp;
+		prev->acct_stamp = now;
+	}
+	if (next->acct_state != ACCT_IOWAIT)
+		next->acct_stamp = now;
+}
+
 /* Yields the CPU.  The current thread is not put to sleep and
    may be scheduled again immediately at the scheduler's whim. */
 /* edward
@@ -362,127 +516,265 @@ thread_yield (void) {
   ASSERT(!intr_context());
 
 	old_level = intr_disable();
-  if (curr != idle_thread) list_insert_ordered (&ready_list, &curr->elem_default, thread_cmp_priority_desc, NULL);
+  if (!curr->is_idle) ready_push (curr);
   do_schedule(THREAD_READY);
   intr_set_level(old_level);
 }
 
-static bool
-	is_left_time_earlier (const struct list_elem *a, const struct list_elem *b, void *aux UNUSED) {
-  struct thread *ta = list_entry (a, struct thread, elem_default);
-  struct thread *tb = list_entry (b, struct thread, elem_default);
-  return ta->wakeup_tick < tb->wakeup_tick;
+/* Sets the current thread's priority to NEW_PRIORITY. */
+void
+thread_set_priority (int new_priority) {
+	if (thread_mlfqs)
+		return;
+	struct thread *curr = thread_current ();
+	enum intr_level old_level = spinlock_acquire (&donation_lock);
+	curr->original_priority = new_priority;
+	donation_refresh (curr);
+	spinlock_release (&donation_lock, old_level);
+	check_preemption();
 }
 
-void
-thread_sleep (void) {
-	struct thread *curr = thread_current();
-	enum intr_level old_level;
+/* Returns the current thread's priority. */
+int
+thread_get_priority (void) {
+	return thread_current ()->priority;
+}
+
+/* Priority donation.
+
+   Each lock keeps a max-heap of the threads waiting for it, keyed by
+   effective priority, and each thread a max-heap of the locks it
+   holds, keyed by each lock's best waiter.  A thread's effective
+   priority is the larger of its own priority and the key on top of
+   its held-lock heap, so reading it is O(1), and a change costs
+   O(log n) per hop down the chain of holders.  Both kinds of heap,
+   lock->holder and waiting_for are guarded by donation_lock.
+
+   Readers of an rwlock hold no lock that a writer could wait on, so
+   each reader also records a struct read_hold, and a writer waiting
+   for the readers to drain (thread->draining, rwlock->drainer)
+   donates to every reader on rw->read_holds.  Those, too, are
+   guarded by donation_lock. */
+
+/* Orders threads in a lock's donors heap by effective priority. */
+bool
+thread_donor_less (const struct pheap_elem *a, const struct pheap_elem *b, void *aux UNUSED) {
+	const struct thread *ta = pheap_entry (a, struct thread, donor_elem);
+	const struct thread *tb = pheap_entry (b, struct thread, donor_elem);
+	return ta->priority < tb->priority;
+}
 
-	ASSERT(!intr_context());
+/* Returns the priority LOCK's waiters donate to its holder, or
+   PRI_MIN - 1 if nobody waits. */
+static int
+lock_donation (const struct lock *lock) {
+	const struct pheap_elem *top = pheap_top (&lock->donors);
+	if (top == NULL)
+		return PRI_MIN - 1;
+	return pheap_entry (top, struct thread, donor_elem)->priority;
+}
 
-	old_level = intr_disable();
-	if (curr != idle_thread) {
-		list_insert_ordered(&sleep_list, &curr->elem_default, is_left_time_earlier, NULL);
-		do_schedule(THREAD_BLOCKED);
+/* Orders the locks in a thread's held_locks heap by donation. */
+static bool
+held_lock_less (const struct pheap_elem *a, const struct pheap_elem *b, void *aux UNUSED) {
+	const struct lock *la = pheap_entry (a, struct lock, holder_elem);
+	const struct lock *lb = pheap_entry (b, struct lock, holder_elem);
+	return lock_donation (la) < lock_donation (lb);
+}
+
+/* edward
+Recomputes T's effective priority from its own priority and the best
+donation among the locks it holds.
+*/
+static void
+donation_refresh (struct thread *t) {
+	int priority = t->original_priority;
+	struct pheap_elem *top = pheap_top (&t->held_locks);
+
+	ASSERT (spinlock_held (&donation_lock));
+	if (top != NULL) {
+		int donated = lock_donation (pheap_entry (top, struct lock, holder_elem));
+		if (donated > priority)
+			priority = donated;
+	}
+	for (int i = 0; i < READ_HOLD_MAX; i++) {
+		struct rwlock *rw = t->read_holds[i].rw;
+		if (rw != NULL && rw->drainer != NULL && rw->drainer->priority > priority)
+			priority = rw->drainer->priority;
 	}
-	intr_set_level(old_level);
+	thread_requeue (t, priority);
 }
 
-void
-thread_wake_up (int64_t current_tick) {
-	/* 🔥 Previous action: timer interrupt
-	this means that this function is called in the interrupt context
-	leading to the necessity of disabling interrupts while manipulating the sleep list
-	*/
-	enum intr_level old_level;
-	old_level = intr_disable();
-	while (!list_empty(&sleep_list)) {
-		struct list_elem *front_elem = list_front(&sleep_list);
-		struct thread *front_thread = list_entry(front_elem, struct thread, elem_default);
-		if (front_thread->wakeup_tick > current_tick) break; /* No more threads to wake up */
-		list_pop_front(&sleep_list); /* Remove from sleep list */
-		front_thread->wakeup_tick = 0; /* Reset wakeup tick */
-		thread_unblock(front_thread); /* Unblock the thread */
+/* Refreshes every reader of RW after its writer's priority changed,
+   passing each change on down. */
+static void
+drain_propagate (struct rwlock *rw) {
+	ASSERT (spinlock_held (&donation_lock));
+	for (struct list_elem *e = list_begin (&rw->read_holds);
+			e != list_end (&rw->read_holds); e = list_next (e)) {
+		struct thread *reader = list_entry (e, struct read_hold, elem)->thread;
+		int old_priority = reader->priority;
+		donation_refresh (reader);
+		if (reader->priority != old_priority)
+			donation_propagate (reader);
 	}
-	intr_set_level(old_level);
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* edward
+T's effective priority changed while it waits for a lock: re-key it
+there and pass the change down the chain of holders, stopping as soon
+as a holder's priority comes out unchanged.
+*/
+static void
+donation_propagate (struct thread *t) {
+	ASSERT (spinlock_held (&donation_lock));
+	while (t->waiting_for != NULL) {
+		struct lock *lock = t->waiting_for;
+		struct thread *holder = lock->holder;
+
+		pheap_update (&lock->donors, &t->donor_elem);
+		if (holder == NULL)
+			return;
+		pheap_update (&holder->held_locks, &lock->holder_elem);
+
+		int old_priority = holder->priority;
+		donation_refresh (holder);
+		if (holder->priority == old_priority)
+			return;
+		t = holder;
+	}
+	/* edward: a writer waits on a semaphore, not a lock, for its readers */
+	if (t->draining != NULL)
+		drain_propagate (t->draining);
+}
+
+/* Called by lock_acquire() when the current thread is about to wait
+   for LOCK: donates its priority to the holder, and on down. */
 void
-thread_set_priority (int new_priority) {
+thread_lock_wait (struct lock *lock) {
 	if (thread_mlfqs)
 		return;
+
 	struct thread *curr = thread_current ();
-	curr->original_priority = new_priority;
-	thread_refresh_priority (curr);
-	if (curr->waiting_for != NULL)
-		thread_propagate_donation (curr);
-	check_preemption();
+	enum intr_level old_level = spinlock_acquire (&donation_lock);
+	curr->waiting_for = lock;
+	pheap_insert (&lock->donors, &curr->donor_elem);
+	donation_propagate (curr);
+	spinlock_release (&donation_lock, old_level);
 }
 
-/* Returns the current thread's priority. */
-int
-thread_get_priority (void) {
+/* Makes the current thread LOCK's holder.  The threads still waiting
+   for LOCK now donate to it. */
+void
+thread_lock_acquired (struct lock *lock) {
 	struct thread *curr = thread_current ();
-	if (thread_mlfqs)
-		return curr->priority;
-	thread_refresh_priority (curr);
-	return curr->priority;
+
+	if (thread_mlfqs) {
+		lock->holder = curr;
+		return;
+	}
+
+	enum intr_level old_level = spinlock_acquire (&donation_lock);
+	if (curr->waiting_for == lock) {
+		pheap_remove (&lock->donors, &curr->donor_elem);
+		curr->waiting_for = NULL;
+	}
+	lock->holder = curr;
+	pheap_insert (&curr->held_locks, &lock->holder_elem);
+	donation_refresh (curr);
+	spinlock_release (&donation_lock, old_level);
 }
 
+/* Drops the current thread's hold on LOCK, and with it whatever LOCK's
+   waiters donated. */
 void
-thread_refresh_priority (struct thread *t) {
-	if (t == NULL)
+thread_lock_released (struct lock *lock) {
+	struct thread *curr = thread_current ();
+
+	if (thread_mlfqs) {
+		lock->holder = NULL;
 		return;
+	}
+
+	enum intr_level old_level = spinlock_acquire (&donation_lock);
+	pheap_remove (&curr->held_locks, &lock->holder_elem);
+	lock->holder = NULL;
+	donation_refresh (curr);
+	spinlock_release (&donation_lock, old_level);
+}
+
+/* Records that the current thread now reads RW, so that a writer
+   waiting on it donates here.  Called before RW's gate is released,
+   so no writer is draining RW yet. */
+void
+thread_read_acquired (struct rwlock *rw) {
 	if (thread_mlfqs)
 		return;
 
-	int max_priority = t->original_priority;
-	struct list_elem *e;
-	for (e = list_begin (&t->donators); e != list_end (&t->donators); e = list_next (e)) {
-		struct thread *donor = list_entry (e, struct thread, elem_donator);
-		if (donor->priority > max_priority)
-			max_priority = donor->priority;
+	struct thread *curr = thread_current ();
+	enum intr_level old_level = spinlock_acquire (&donation_lock);
+	for (int i = 0; i < READ_HOLD_MAX; i++) {
+		struct read_hold *hold = &curr->read_holds[i];
+		if (hold->rw == NULL) {
+			hold->rw = rw;
+			hold->thread = curr;
+			list_push_back (&rw->read_holds, &hold->elem);
+			break;
+		}
 	}
-	t->priority = max_priority;
+	spinlock_release (&donation_lock, old_level);
 }
 
+/* Drops the current thread's read hold on RW, and whatever RW's
+   waiting writer donated through it. */
 void
-thread_remove_lock_donations (struct lock *lock) {
-	if (lock == NULL)
-		return;
+thread_read_released (struct rwlock *rw) {
 	if (thread_mlfqs)
 		return;
 
 	struct thread *curr = thread_current ();
-	struct list_elem *e = list_begin (&curr->donators);
-	while (e != list_end (&curr->donators)) {
-		struct thread *donor = list_entry (e, struct thread, elem_donator);
-		if (donor->waiting_for == lock)
-			e = list_remove (e);
-		else
-			e = list_next (e);
+	enum intr_level old_level = spinlock_acquire (&donation_lock);
+	for (int i = 0; i < READ_HOLD_MAX; i++) {
+		struct read_hold *hold = &curr->read_holds[i];
+		if (hold->rw == rw) {
+			list_remove (&hold->elem);
+			hold->rw = NULL;
+			donation_refresh (curr);
+			break;
+		}
 	}
+	spinlock_release (&donation_lock, old_level);
 }
 
+/* Called by rwlock_acquire_write() when the current thread, holding
+   RW's gate, is about to wait for RW's readers: donates its priority
+   to each of them, and on down. */
 void
-thread_propagate_donation (struct thread *t) {
-	if (t == NULL)
+thread_drain_wait (struct rwlock *rw) {
+	if (thread_mlfqs)
 		return;
+
+	struct thread *curr = thread_current ();
+	enum intr_level old_level = spinlock_acquire (&donation_lock);
+	curr->draining = rw;
+	rw->drainer = curr;
+	drain_propagate (rw);
+	spinlock_release (&donation_lock, old_level);
+}
+
+/* RW's readers have drained.  They released their holds, and with
+   them the donation, on the way out. */
+void
+thread_drain_done (struct rwlock *rw) {
 	if (thread_mlfqs)
 		return;
 
-	int depth = 0;
-	while (t->waiting_for != NULL && depth < DONATION_MAX_DEPTH) {
-		struct lock *lock = t->waiting_for;
-		struct thread *holder = lock->holder;
-		if (holder == NULL)
-			break;
-		thread_refresh_priority (holder);
-		t = holder;
-		depth++;
-	}
+	struct thread *curr = thread_current ();
+	enum intr_level old_level = spinlock_acquire (&donation_lock);
+	ASSERT (list_empty (&rw->read_holds));
+	curr->draining = NULL;
+	rw->drainer = NULL;
+	spinlock_release (&donation_lock, old_level);
 }
 
 /* Sets the current thread's nice value to NICE. */
@@ -524,18 +816,23 @@ thread_get_recent_cpu (void) {
 	return value;
 }
 
+/* edward
+Only the running thread's recent_cpu changes between seconds, so the
+4-tick priority refresh touches just that thread.  The once-a-second
+decay is applied to runnable threads only.
+*/
 static void
 mlfqs_tick (void) {
 	struct thread *curr = thread_current ();
-	if (curr != idle_thread)
+	if (!curr->is_idle && !thread_is_worker (curr))
 		curr->recent_cpu = fp_add_int (curr->recent_cpu, 1);
 	mlfqs_ticks++;
 	if (mlfqs_ticks % TIMER_FREQ == 0) {
 		mlfqs_update_load_avg ();
-		mlfqs_update_recent_cpu_all ();
+		mlfqs_close_second ();
 	}
 	if (mlfqs_ticks % 4 == 0) {
-		mlfqs_update_priority_all ();
+		mlfqs_update_priority (curr);
 		check_preemption ();
 	}
 }
@@ -550,53 +847,238 @@ mlfqs_update_load_avg (void) {
 
 static int
 mlfqs_ready_threads (void) {
-	int n_ready_threads = list_size (&ready_list);
-	if (thread_current () != idle_thread)
+	int n_ready_threads = sched.ready_cnt;
+	if (!sched.curr->is_idle && !thread_is_worker (sched.curr))
 		n_ready_threads++;
 	return n_ready_threads;
 }
 
+static inline int
+mlfqs_decay (int recent_cpu, int coeff, int nice) {
+	return fp_add_int (fp_mul (coeff, recent_cpu), nice);
+}
+
+/* Completely fair scheduling.
+
+   Each tick a thread runs adds CFS_TICK * NICE_0_WEIGHT / weight to
+   its vruntime, where the weight falls by about 1.25x per nice level,
+   so runnable threads split the CPU in proportion to their weights.
+   The ready threads sit in a pairing heap, least vruntime on top.
+   New and woken threads are placed no further back than
+   min_vruntime less one granularity, so a sleeper gets a little
+   credit but cannot bank CPU time while it sleeps. */
+#define NICE_0_WEIGHT 1024
+#define CFS_TICK 1024
+
+/* Weight of each nice value, -20 to 20. */
+static const int cfs_weights[41] = {
+	/* -20 */ 88761, 71755, 56483, 46273, 36291,
+	/* -15 */ 29154, 23254, 18705, 14949, 11916,
+	/* -10 */ 9548, 7620, 6100, 4904, 3906,
+	/*  -5 */ 3121, 2501, 1991, 1586, 1277,
+	/*   0 */ 1024, 820, 655, 526, 423,
+	/*   5 */ 335, 272, 215, 172, 137,
+	/*  10 */ 110, 87, 70, 56, 45,
+	/*  15 */ 36, 29, 23, 18, 15,
+	/*  20 */ 12,
+};
+
+/* Orders the cfs_queue.  The heap keeps its greatest element on
+   top, so more vruntime sorts as less. */
+static bool
+cfs_less (const struct pheap_elem *a, const struct pheap_elem *b, void *aux UNUSED) {
+	return pheap_entry (a, struct thread, cfs_elem)->vruntime
+		> pheap_entry (b, struct thread, cfs_elem)->vruntime;
+}
+
+/* Returns the ready thread with the least vruntime, or NULL. */
+static struct thread *
+cfs_first (void) {
+	struct pheap_elem *e = pheap_top (&sched.cfs_queue);
+	return e != NULL ? pheap_entry (e, struct thread, cfs_elem) : NULL;
+}
+
 /* edward
-Traverse the killing list and update the recent cpu value
+Charges CURR one tick of vruntime, moves min_vruntime up, and asks
+for a switch once CURR has had its granularity and is no longer the
+thread furthest behind.  Called from the timer interrupt.
 */
 static void
-mlfqs_update_recent_cpu_all (void) {
-	int temp_numerator = fp_mul_int (load_avg, 2);
-	int temp_denominator = fp_add_int (temp_numerator, 1);
-	int temp = temp_denominator == 0 ? 0 : fp_div (temp_numerator, temp_denominator);
-	struct list_elem *e;
-	for (e = list_begin (&integrated); e != list_end (&integrated); e = list_next (e)) {
-		struct thread *t = list_entry (e, struct thread, elem_integrated);
-		if (t == idle_thread) continue;
-		int term1 = fp_mul (temp, t->recent_cpu);
-		t->recent_cpu = fp_add_int (term1, t->nice);
-	}
+cfs_tick (struct thread *curr) {
+	enum intr_level old_level = spinlock_acquire (&sched.rq_lock);
+	struct thread *first = cfs_first ();
+	int64_t floor;
+
+	if (!curr->is_idle) {
+		curr->vruntime += CFS_TICK * NICE_0_WEIGHT / cfs_weights[curr->nice + 20];
+		floor = curr->vruntime;
+		if (first != NULL && first->vruntime < floor)
+			floor = first->vruntime;
+	} else
+		floor = first != NULL ? first->vruntime : sched.min_vruntime;
+	if (floor > sched.min_vruntime)
+		sched.min_vruntime = floor;
+
+	if (first != NULL && (curr->is_idle || (sched.thread_ticks >= (unsigned) cfs_granularity
+					&& first->vruntime < curr->vruntime)))
+		intr_yield_on_return ();
+	spinlock_release (&sched.rq_lock, old_level);
+}
+
+/* Places T, about to be made ready, relative to the ready queue. */
+static void
+cfs_place (struct thread *t) {
+	int64_t floor = sched.min_vruntime - (int64_t) cfs_granularity * CFS_TICK;
+	if (t->vruntime < floor)
+		t->vruntime = floor;
+}
+
+/* Returns true if the first ready thread should take over from CURR
+   right away: CURR is idle, or is more than a tick's worth of
+   vruntime ahead of it. */
+static bool
+cfs_preempts (const struct thread *curr) {
+	struct thread *first = cfs_first ();
+	return first != NULL
+		&& (curr->is_idle || first->vruntime + CFS_TICK < curr->vruntime);
 }
 
 /* edward
-Traverse the whole list and update the priority
+Closes a second from the timer interrupt: adds its decay coefficient to
+the running totals and applies it to the running threads.  The ready threads are left to
+mlfqs_decay_ready() on the work queue, so the interrupt does O(1)
+work however many threads are ready.
 */
 static void
-mlfqs_update_priority_all (void) {
-	struct list_elem *e;
-	for (e = list_begin (&integrated); e != list_end (&integrated); e = list_next (e)) {
-		struct thread *t = list_entry (e, struct thread, elem_integrated);
-		mlfqs_update_priority (t);
+mlfqs_close_second (void) {
+	int numerator = fp_mul_int (load_avg, 2);
+	int denominator = fp_add_int (numerator, 1);
+	int coeff = denominator == 0 ? 0 : fp_div (numerator, denominator);
+
+	mlfqs_epoch++;
+	decay_advance (coeff);
+
+	struct thread *t = sched.curr;
+	if (!t->is_idle)
+		t->recent_cpu = mlfqs_decay (t->recent_cpu, coeff, t->nice);
+	mlfqs_stamp (t);
+	work_queue (&mlfqs_work);
+}
+
+/* edward
+Work item: folds the closed second into every ready thread's recent_cpu
+and priority, one thread per interrupt-off step.  Each queue is rotated
+once through, which keeps FIFO order inside a level; a thread whose
+priority changes goes to the back of its new level.
+*/
+static void
+mlfqs_decay_ready (void *aux UNUSED) {
+	for (int pri = PRI_MAX; pri >= PRI_MIN; pri--) {
+		struct list *q = &sched.ready_queues[pri];
+		enum intr_level old_level = spinlock_acquire (&sched.rq_lock);
+		size_t n = list_size (q);
+		spinlock_release (&sched.rq_lock, old_level);
+
+		while (n-- > 0) {
+			old_level = spinlock_acquire (&sched.rq_lock);
+			if (list_empty (q)) {
+				spinlock_release (&sched.rq_lock, old_level);
+				break;
+			}
+			struct thread *t = list_entry (list_front (q), struct thread, elem_default);
+			rq_remove (t);
+			if (mlfqs_catch_up (t))
+				t->original_priority = t->priority = mlfqs_priority (t);
+			rq_add (t);
+			spinlock_release (&sched.rq_lock, old_level);
+		}
 	}
-	list_sort (&ready_list, thread_cmp_priority_desc, NULL);
 }
 
 /* edward
-Update priority of a thread
+Folds the seconds T missed, blocked or waiting in a ready queue, into
+its recent_cpu from the running totals (see DECAY_NOW), in constant
+time however long T was away.  Returns true if recent_cpu changed, so
+the caller can refresh T's priority.
 */
+static bool
+mlfqs_catch_up (struct thread *t) {
+	if (t->mlfqs_epoch == mlfqs_epoch || t->is_idle) {
+		mlfqs_stamp (t);
+		return false;
+	}
+
+	const struct decay_mark *from = &t->mlfqs_mark;
+	int64_t x = t->recent_cpu;
+	if (t->mlfqs_epoch < decay_reset_epoch) {
+		from = &decay_reset;
+		x = int_to_fp (t->nice);
+	}
+	int64_t a = decay_ratio (&decay_now, from);
+	int64_t s = decay_now.s - a * from->s / DECAY_A_ONE;
+	t->recent_cpu = a * x / DECAY_A_ONE + t->nice * s / (DECAY_S_ONE / FP_F);
+	mlfqs_stamp (t);
+	return true;
+}
+
+/* Records that T's recent_cpu is up to date as of now. */
 static void
-mlfqs_update_priority (struct thread *t) {
-	if (t == NULL || t == idle_thread)
+mlfqs_stamp (struct thread *t) {
+	t->mlfqs_epoch = mlfqs_epoch;
+	t->mlfqs_mark = decay_now;
+}
+
+/* Moves DECAY_NOW past a second that closed with coefficient COEFF. */
+static void
+decay_advance (int coeff) {
+	if (coeff == 0) {
+		decay_now = decay_reset;
+		decay_reset_epoch = mlfqs_epoch;
 		return;
+	}
+
+	/* COEFF is below 1, so P shrinks and never needs shifting up. */
+	uint64_t p = (uint64_t) decay_now.p_mant * coeff;
+	int shift = 32 - __builtin_clzll (p);
+	decay_now.p_mant = p >> shift;
+	decay_now.p_exp += shift - FP_SHIFT;
+	decay_now.s = decay_now.s * coeff / FP_F + DECAY_S_ONE;
+}
+
+/* Returns TO's P over FROM's P, an earlier mark's, in Q30. */
+static int64_t
+decay_ratio (const struct decay_mark *to, const struct decay_mark *from) {
+	int64_t shift = from->p_exp - to->p_exp;
+	uint64_t q = ((uint64_t) to->p_mant << 30) / from->p_mant;
+
+	ASSERT (shift >= 0);
+	if (shift >= 62)
+		return 0;
+	q >>= shift;
+	return q < DECAY_A_ONE ? (int64_t) q : DECAY_A_ONE;
+}
+
+/* Returns the MLFQS priority T's recent_cpu and nice call for.  Idle
+   and worker threads keep the priority they were created with. */
+static int
+mlfqs_priority (const struct thread *t) {
+	if (t->is_idle || thread_is_worker (t))
+		return t->priority;
 	int priority = PRI_MAX - fp_to_int_nearest (fp_div_int (t->recent_cpu, 4)) - t->nice * 2;
 	if (priority > PRI_MAX) priority = PRI_MAX;
 	else if (priority < PRI_MIN) priority = PRI_MIN;
-	t->priority = priority;
+	return priority;
+}
+
+/* edward
+Update priority of a thread
+*/
+static void
+mlfqs_update_priority (struct thread *t) {
+	if (t == NULL || t->is_idle || thread_is_worker (t))
+		return;
+	int priority = mlfqs_priority (t);
+	thread_requeue (t, priority);
 	t->original_priority = priority;
 }
 
@@ -656,7 +1138,7 @@ static void
 idle (void *idle_started_ UNUSED) {
 	struct semaphore *idle_started = idle_started_;
 
-	idle_thread = thread_current ();
+	sched.idle_thread = thread_current ();
 	sema_up (idle_started);
 
 	for (;;) {
@@ -664,6 +1146,9 @@ idle (void *idle_started_ UNUSED) {
 		intr_disable ();
 		thread_block ();
 
+		/* Nothing is runnable: skip ticks until the next timer. */
+		timer_idle_enter ();
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -705,14 +1190,17 @@ init_thread (struct thread *t, const char *name, int priority) {
 	memset (t, 0, sizeof *t);
 	t->status = THREAD_BLOCKED;
 	strlcpy (t->name, name, sizeof t->name);
-	t->tf.rsp = (uint64_t) t + PGSIZE - sizeof (void *);
 	t->priority = priority;
 	t->original_priority = priority;
 	t->waiting_for = NULL;
 	t->nice = 0;
 	t->recent_cpu = 0;
+	mlfqs_stamp (t);
 	t->exit_status = 0;
-	list_init (&t->donators);
+	t->acct_state = ACCT_SYS;
+	t->acct_stamp = rdtsc ();
+	pheap_init (&t->held_locks, held_lock_less, NULL);
+	t->vruntime = sched.min_vruntime;
 	t->magic = THREAD_MAGIC;
 	list_push_back (&integrated, &t->elem_integrated);
 }
@@ -724,15 +1212,167 @@ init_thread (struct thread *t, const char *name, int priority) {
    idle_thread. */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
-		return idle_thread;
-	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem_default);
+	struct thread *t = ready_pop ();
+	return t != NULL ? t : sched.idle_thread;
+}
+
+/* Initializes the scheduler state. */
+static void
+sched_init (void) {
+	spinlock_init (&sched.rq_lock, "run queue");
+	for (int i = 0; i < READY_QUEUES; i++)
+		list_init (&sched.ready_queues[i]);
+	sched.ready_mask = 0;
+	sched.ready_cnt = 0;
+	pheap_init (&sched.cfs_queue, cfs_less, NULL);
+	sched.min_vruntime = 0;
+	sched.curr = sched.idle_thread = NULL;
+	list_init (&sched.destruction_req);
+	list_init (&sched.tcb_cache);
+	sched.tcb_cached = 0;
+	sched.thread_ticks = 0;
+}
+
+/* edward
+Returns a page for a new thread, preferring a recycled one.
+A recycled page is not zeroed: init_thread() clears the struct thread
+header and nothing reads the stack below it before writing.
+*/
+static struct thread *
+tcb_alloc (void) {
+	struct thread *t = NULL;
+	enum intr_level old_level = intr_disable ();
+
+	if (!list_empty (&sched.tcb_cache)) {
+		t = list_entry (list_pop_front (&sched.tcb_cache), struct thread, elem_default);
+		sched.tcb_cached--;
+		sched.create_hits++;
+	}
+	intr_set_level (old_level);
+
+	if (t == NULL)
+		t = palloc_get_page (PAL_ZERO);
+	return t;
+}
+
+/* edward
+Retires the page of dead thread T: back to the cache while it has
+room, otherwise to the page allocator.  Interrupts must be off.
+*/
+static void
+tcb_free (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	t->magic = 0;
+	if (sched.tcb_cached < TCB_CACHE_MAX) {
+		list_push_front (&sched.tcb_cache, &t->elem_default);
+		sched.tcb_cached++;
+	} else
+		palloc_free_page (t);
+}
+
+/* edward
+Appends T to the tail of the queue for its current priority.  Caller
+holds rq_lock.
+*/
+static void
+rq_add (struct thread *t) {
+	ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+	if (thread_cfs) {
+		pheap_insert (&sched.cfs_queue, &t->cfs_elem);
+		sched.ready_cnt++;
+		return;
+	}
+	list_push_back (&sched.ready_queues[t->priority], &t->elem_default);
+	sched.ready_mask |= 1ULL << t->priority;
+	sched.ready_cnt++;
+}
+
+/* edward
+Unlinks ready thread T from the run queue.  Caller holds rq_lock.
+*/
+static void
+rq_remove (struct thread *t) {
+	struct list *q = &sched.ready_queues[t->priority];
+
+	if (thread_cfs) {
+		pheap_remove (&sched.cfs_queue, &t->cfs_elem);
+		sched.ready_cnt--;
+		return;
+	}
+	list_remove (&t->elem_default);
+	if (list_empty (q))
+		sched.ready_mask &= ~(1ULL << t->priority);
+	sched.ready_cnt--;
+}
+
+/* edward
+Queues T on the run queue.
+*/
+static void
+ready_push (struct thread *t) {
+	enum intr_level old_level = spinlock_acquire (&sched.rq_lock);
+
+	rq_add (t);
+	spinlock_release (&sched.rq_lock, old_level);
+}
+
+/* edward
+Pops the oldest thread of the highest non-empty priority, or
+under -cfs the one with the least vruntime.  Returns NULL if nothing is
+ready.
+*/
+static struct thread *
+ready_pop (void) {
+	enum intr_level old_level = spinlock_acquire (&sched.rq_lock);
+	struct thread *t = NULL;
+
+	if (thread_cfs)
+		t = cfs_first ();
+	else if (sched.ready_mask != 0) {
+		int pri = 63 - __builtin_clzll (sched.ready_mask);
+		t = list_entry (list_front (&sched.ready_queues[pri]), struct thread, elem_default);
+	}
+	if (t != NULL)
+		rq_remove (t);
+	spinlock_release (&sched.rq_lock, old_level);
+	return t;
+}
+
+/* Returns the highest priority that has a ready thread, or -1. */
+static int
+ready_top_priority (void) {
+	uint64_t mask = sched.ready_mask;
+	if (mask == 0)
+		return -1;
+	return 63 - __builtin_clzll (mask);
+}
+
+/* edward
+Sets T's effective priority.  A ready thread is moved to the tail of
+its new queue so the run queue never has to be re-sorted.
+*/
+static void
+thread_requeue (struct thread *t, int priority) {
+	enum intr_level old_level;
+
+	if (t->priority == priority)
+		return;
+	old_level = spinlock_acquire (&sched.rq_lock);
+	if (t->status == THREAD_READY) {
+		rq_remove (t);
+		t->priority = priority;
+		rq_add (t);
+	} else
+		t->priority = priority;
+	spinlock_release (&sched.rq_lock, old_level);
 }
 
 /*
 Use iretq to launch the thread
-edward: return from interrupt context to user context
+edward: return from interrupt context to user context.
+Only process start and fork come through here now; switches between
+threads use switch_to().
 */
 void
 do_iret (struct intr_frame *tf) {
@@ -761,75 +1401,6 @@ do_iret (struct intr_frame *tf) {
 			: : "g" ((uint64_t) tf) : "memory");
 }
 
-/* Switching the thread by activating the new thread's page
-   tables, and, if the previous thread is dying, destroying it.
-
-   At this function's invocation, we just switched from thread
-   PREV, the new thread is already running, and interrupts are
-   still disabled.
-
-   It's not safe to call printf() until the thread switch is
-   complete.  In practice that means that printf()s should be
-   added at the end of the function. */
-static void
-thread_launch (struct thread *th) {
-	uint64_t tf_cur = (uint64_t) &running_thread ()->tf;
-	uint64_t tf = (uint64_t) &th->tf;
-	ASSERT (intr_get_level () == INTR_OFF);
-
-	/* The main switching logic.
-	 * We first restore the whole execution context into the intr_frame
-	 * and then switching to the next thread by calling do_iret.
-	 * Note that, we SHOULD NOT use any stack from here
-	 * until switching is done. */
-	__asm __volatile (
-			/* Store registers that will be used. */
-			"push %%rax\n"
-			"push %%rbx\n"
-			"push %%rcx\n"
-			/* Fetch input once */
-			"movq %0, %%rax\n"
-			"movq %1, %%rcx\n"
-			"movq %%r15, 0(%%rax)\n"
-			"movq %%r14, 8(%%rax)\n"
-			"movq %%r13, 16(%%rax)\n"
-			"movq %%r12, 24(%%rax)\n"
-			"movq %%r11, 32(%%rax)\n"
-			"movq %%r10, 40(%%rax)\n"
-			"movq %%r9, 48(%%rax)\n"
-			"movq %%r8, 56(%%rax)\n"
-			"movq %%rsi, 64(%%rax)\n"
-			"movq %%rdi, 72(%%rax)\n"
-			"movq %%rbp, 80(%%rax)\n"
-			"movq %%rdx, 88(%%rax)\n"
-			"pop %%rbx\n"              // Saved rcx
-			"movq %%rbx, 96(%%rax)\n"
-			"pop %%rbx\n"              // Saved rbx
-			"movq %%rbx, 104(%%rax)\n"
-			"pop %%rbx\n"              // Saved rax
-			"movq %%rbx, 112(%%rax)\n"
-			"addq $120, %%rax\n"
-			"movw %%es, (%%rax)\n"
-			"movw %%ds, 8(%%rax)\n"
-			"addq $32, %%rax\n"
-			"call __next\n"         // read the current rip.
-			"__next:\n"
-			"pop %%rbx\n"
-			"addq $(out_iret -  __next), %%rbx\n"
-			"movq %%rbx, 0(%%rax)\n" // rip
-			"movw %%cs, 8(%%rax)\n"  // cs
-			"pushfq\n"
-			"popq %%rbx\n"
-			"mov %%rbx, 16(%%rax)\n" // eflags
-			"mov %%rsp, 24(%%rax)\n" // rsp
-			"movw %%ss, 32(%%rax)\n"
-			"mov %%rcx, %%rdi\n"
-			"call do_iret\n"
-			"out_iret:\n"
-			: : "g"(tf_cur), "g" (tf) : "memory"
-			);
-}
-
 /* Schedules a new process. At entry, interrupts must be off.
  * This function modify current thread's status to status and then
  * finds another thread to run and switches to it.
@@ -842,9 +1413,13 @@ static void
 do_schedule(int status) {
 	ASSERT (intr_get_level () == INTR_OFF);
 	ASSERT (thread_current()->status == THREAD_RUNNING);
-	while (!list_empty (&destruction_req)) {
-		struct thread *victim = list_entry (list_pop_front (&destruction_req), struct thread, elem_default);
-		palloc_free_page(victim);
+	struct list *destruction_req = &sched.destruction_req;
+	while (!list_empty (destruction_req)) {
+		struct thread *victim = list_entry (list_pop_front (destruction_req), struct thread, elem_default);
+		uint64_t exit_start = victim->exit_start;
+		tcb_free (victim);
+		sched.exits++;
+		sched.exit_cycles += rdtsc () - exit_start;
 	}
 	thread_current ()->status = status;
 	schedule ();
@@ -861,8 +1436,11 @@ schedule (void) {
 	/* Mark us as running. */
 	next->status = THREAD_RUNNING;
 
+	KTRACE_EVENT (KT_SWITCH, next->tid, curr->status);
+
 	/* Start new time slice. */
-	thread_ticks = 0;
+	sched.thread_ticks = 0;
+	sched.curr = next;
 
 #ifdef USERPROG
 	/* Activate the new address space. */
@@ -879,12 +1457,11 @@ schedule (void) {
 		   schedule(). */
 		if (curr && curr->status == THREAD_DYING && curr != initial_thread) {
 			ASSERT (curr != next);
-			list_push_back (&destruction_req, &curr->elem_default);
+			list_push_back (&sched.destruction_req, &curr->elem_default);
 		}
 
-		/* Before switching the thread, we first save the information
-		 * of current running. */
-		thread_launch (next);
+		acct_switch (curr, next);
+		switch_to (&curr->ksp, next->ksp);
 	}
 }
 
@@ -907,11 +1484,14 @@ And if it has to, hand over.
 */
 void check_preemption(void) {
 	enum intr_level old_level = intr_disable ();
-	if (!list_empty (&ready_list)) {
+	if (thread_cfs) {
+		if (cfs_preempts (thread_current ())) {
+			if (intr_context ()) intr_yield_on_return ();
+			else thread_yield ();
+		}
+	} else if (sched.ready_mask != 0) {
 		struct thread *curr = thread_current ();
-		struct list_elem *front_elem = list_front (&ready_list);
-		struct thread *front_thread = list_entry (front_elem, struct thread, elem_default);
-		if (front_thread->priority > curr->priority) {
+		if (ready_top_priority () > curr->priority) {
 			if (intr_context ()) intr_yield_on_return ();
 			else thread_yield ();
 		}
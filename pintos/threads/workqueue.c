@@ -0,0 +1,90 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/spinlock.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Work items waiting for the worker, oldest first. */
+static struct list pending;
+static struct spinlock pending_lock;
+
+/* The worker thread, and whether it is blocked waiting for work.
+   Both guarded by PENDING_LOCK. */
+static struct thread *worker;
+static bool worker_idle;
+
+static thread_func worker_main;
+
+/* Starts the worker thread.  Work queued before this runs once the
+   worker is up. */
+void
+workqueue_init (void) {
+	struct semaphore started;
+
+	list_init (&pending);
+	spinlock_init (&pending_lock, "workqueue");
+	sema_init (&started, 0);
+	thread_create ("worker", PRI_MAX, worker_main, &started);
+	sema_down (&started);
+}
+
+/* Initializes W to run FUNC (AUX) when queued. */
+void
+work_init (struct work *w, work_func *func, void *aux) {
+	w->func = func;
+	w->aux = aux;
+	w->pending = false;
+}
+
+/* Queues W for the worker.  Callable from interrupt handlers.
+   Returns false if W was already queued and has not yet started. */
+bool
+work_queue (struct work *w) {
+	enum intr_level old_level = spinlock_acquire (&pending_lock);
+	bool queued = !w->pending;
+
+	if (queued) {
+		w->pending = true;
+		list_push_back (&pending, &w->elem);
+		if (worker_idle) {
+			worker_idle = false;
+			thread_unblock (worker);
+		}
+	}
+	spinlock_release (&pending_lock, old_level);
+
+	if (queued)
+		check_preemption ();
+	return queued;
+}
+
+/* Returns true if T is the worker thread.  The scheduler keeps it at
+   PRI_MAX under -mlfqs too. */
+bool
+thread_is_worker (const struct thread *t) {
+	return t != NULL && t == worker;
+}
+
+/* The worker thread: runs queued work in order, forever. */
+static void
+worker_main (void *started_) {
+	struct semaphore *started = started_;
+	enum intr_level old_level = spinlock_acquire (&pending_lock);
+
+	worker = thread_current ();
+	sema_up (started);
+	for (;;) {
+		while (list_empty (&pending)) {
+			worker_idle = true;
+			thread_block_on (&pending_lock);
+		}
+
+		struct work *w = list_entry (list_pop_front (&pending), struct work, elem);
+		w->pending = false;
+		spinlock_release (&pending_lock, old_level);
+
+		w->func (w->aux);
+		old_level = spinlock_acquire (&pending_lock);
+	}
+}
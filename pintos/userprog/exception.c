@@ -2,8 +2,11 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/syscall.h"
 #include "threads/interrupt.h"
+#include "threads/ktrace.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
 #include "intrinsic.h"
 
 /* Number of page faults processed. */
@@ -139,16 +142,26 @@ page_fault (struct intr_frame *f) {
 	not_present = (f->error_code & PF_P) == 0;
 	write = (f->error_code & PF_W) != 0;
 	user = (f->error_code & PF_U) != 0;
+	KTRACE_EVENT (KT_FAULT, fault_addr, f->error_code & (PF_P | PF_W | PF_U));
 
 #ifdef VM
 	/* For project 3 and later. */
-	if (vm_try_handle_fault (f, fault_addr, user, write, not_present))
+	enum cpu_acct prev_acct = thread_acct_enter (ACCT_FAULT);
+	bool handled = vm_try_handle_fault (f, fault_addr, user, write, not_present);
+	thread_acct_enter (prev_acct);
+	if (handled)
 		return;
 #endif
 
 	/* Count page faults. */
 	page_fault_cnt++;
 
+	/* edward: the kernel only touches user memory through get_user()
+	   and the copy_*_user() helpers in syscall.c.  Report their
+	   failures back to them; any other kernel fault panics below. */
+	if (!user && is_user_vaddr (fault_addr) && user_access_fixup (f))
+		return;
+
 	if(user) {
 		thread_current()->exit_status = -1;
 		thread_exit();
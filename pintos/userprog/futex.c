@@ -0,0 +1,141 @@
+#include "userprog/futex.h"
+#include <hash.h>
+#include <list.h>
+#include <stdint.h>
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/syscall.h"
+#ifdef VM
+#include "vm/vm.h"
+#endif
+
+/* Fast user-space mutexes.
+ *
+ * A futex is just an int in user memory.  User code handles the
+ * uncontended case with atomic instructions alone and only calls
+ * futex_wait() to sleep until the word changes, or futex_wake() after
+ * changing it to rouse sleepers.
+ *
+ * A futex is named by a key.  A word in a private mapping is keyed by
+ * the address space and its user address; a word in a shared segment
+ * is keyed by the segment and its offset in it, so processes that map
+ * the segment at different addresses still meet.  Waiters hang off one
+ * of FUTEX_BUCKETS hashed buckets, and each bucket's lock is held
+ * across the value check in futex_wait(), so a wake that follows a
+ * change to the word cannot slip in between the check and the sleep. */
+
+#define FUTEX_BUCKETS 64
+
+struct futex_key {
+	const void *space;          /* Address space, or shared segment. */
+	uintptr_t offset;           /* User address, or offset in segment. */
+};
+
+/* A thread blocked in futex_wait(). */
+struct futex_waiter {
+	struct futex_key key;
+	struct semaphore sema;      /* Upped by futex_wake(). */
+	struct list_elem elem;      /* In its bucket's WAITERS. */
+};
+
+struct futex_bucket {
+	struct lock lock;           /* Guards WAITERS. */
+	struct list waiters;
+};
+
+static struct futex_bucket buckets[FUTEX_BUCKETS];
+
+/* Initializes the futex buckets. */
+void
+futex_init (void) {
+	for (int i = 0; i < FUTEX_BUCKETS; i++) {
+		lock_init (&buckets[i].lock);
+		list_init (&buckets[i].waiters);
+	}
+}
+
+/* Computes the key for the futex word at UADDR in the current
+   process. */
+static void
+futex_key (const int *uaddr, struct futex_key *key) {
+	struct thread *curr = thread_current ();
+
+#ifdef VM
+	struct page *page = spt_find_page (&curr->spt, (void *) uaddr);
+	size_t idx;
+	struct shm_segment *seg = page != NULL ? anon_shared_segment (page, &idx) : NULL;
+	if (seg != NULL) {
+		key->space = seg;
+		key->offset = idx * PGSIZE + pg_ofs (uaddr);
+		return;
+	}
+#endif
+	key->space = curr->pml4;
+	key->offset = (uintptr_t) uaddr;
+}
+
+static struct futex_bucket *
+key_bucket (const struct futex_key *key) {
+	return &buckets[hash_bytes (key, sizeof *key) % FUTEX_BUCKETS];
+}
+
+static bool
+key_equal (const struct futex_key *a, const struct futex_key *b) {
+	return a->space == b->space && a->offset == b->offset;
+}
+
+/* Sleeps until a futex_wake() on UADDR, provided *UADDR still equals
+   VAL.  Returns 0 after a wakeup, -1 right away if *UADDR != VAL, or
+   FUTEX_FAULT if UADDR cannot be read. */
+int
+futex_wait (const int *uaddr, int val) {
+	struct futex_waiter w;
+	struct futex_bucket *b;
+	int cur;
+
+	futex_key (uaddr, &w.key);
+	b = key_bucket (&w.key);
+
+	lock_acquire (&b->lock);
+	if (!copy_from_user (&cur, uaddr, sizeof cur)) {
+		lock_release (&b->lock);
+		return FUTEX_FAULT;
+	}
+	if (cur != val) {
+		lock_release (&b->lock);
+		return -1;
+	}
+	sema_init (&w.sema, 0);
+	list_push_back (&b->waiters, &w.elem);
+	lock_release (&b->lock);
+
+	sema_down (&w.sema);
+	return 0;
+}
+
+/* Wakes up to COUNT threads waiting on UADDR, in the order they
+   started waiting.  Returns how many were woken. */
+int
+futex_wake (const int *uaddr, int count) {
+	struct futex_key key;
+	struct futex_bucket *b;
+	struct list_elem *e;
+	int woken = 0;
+
+	futex_key (uaddr, &key);
+	b = key_bucket (&key);
+
+	lock_acquire (&b->lock);
+	for (e = list_begin (&b->waiters); e != list_end (&b->waiters) && woken < count; ) {
+		struct futex_waiter *w = list_entry (e, struct futex_waiter, elem);
+		if (key_equal (&w->key, &key)) {
+			e = list_remove (e);
+			sema_up (&w->sema);
+			woken++;
+		} else
+			e = list_next (e);
+	}
+	lock_release (&b->lock);
+	return woken;
+}
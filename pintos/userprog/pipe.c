@@ -0,0 +1,153 @@
+#include "userprog/pipe.h"
+#include <debug.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Bytes of buffering in a pipe. */
+#define PIPE_SIZE PGSIZE
+
+/* An anonymous pipe.
+ *
+ * Data lives in a one-page ring buffer.  HEAD and TAIL run freely and
+ * are reduced modulo PIPE_SIZE, so the buffer holds TAIL - HEAD bytes
+ * and full and empty are never confused.  READERS and WRITERS count
+ * the descriptors open on each end across all processes; the pipe is
+ * freed when both reach zero. */
+struct pipe {
+	uint8_t *buf;               /* PIPE_SIZE bytes of data. */
+	size_t head;                /* Next byte to read. */
+	size_t tail;                /* Next byte to write. */
+	int readers;                /* Descriptors open on the read end. */
+	int writers;                /* Descriptors open on the write end. */
+	struct lock lock;           /* Guards all of the above. */
+	struct condition not_empty; /* Signaled when data or EOF arrives. */
+	struct condition not_full;  /* Signaled when room or EPIPE arrives. */
+};
+
+/* Creates a pipe with one descriptor open on each end.  Returns a
+ * null pointer if memory allocation fails. */
+struct pipe *
+pipe_create (void) {
+	struct pipe *pipe = malloc (sizeof *pipe);
+	if (pipe == NULL)
+		return NULL;
+	pipe->buf = palloc_get_page (0);
+	if (pipe->buf == NULL) {
+		free (pipe);
+		return NULL;
+	}
+	pipe->head = pipe->tail = 0;
+	pipe->readers = pipe->writers = 1;
+	lock_init (&pipe->lock);
+	cond_init (&pipe->not_empty);
+	cond_init (&pipe->not_full);
+	return pipe;
+}
+
+/* Records one more descriptor open on the write end of PIPE if
+ * WRITE_END, otherwise on the read end (for fork and dup2). */
+void
+pipe_open_end (struct pipe *pipe, bool write_end) {
+	lock_acquire (&pipe->lock);
+	if (write_end)
+		pipe->writers++;
+	else
+		pipe->readers++;
+	lock_release (&pipe->lock);
+}
+
+/* Drops one descriptor from the write end of PIPE if WRITE_END,
+ * otherwise from the read end.  Closing the last writer gives readers
+ * end of file; closing the last reader makes writes fail.  Frees
+ * PIPE once neither end is open. */
+void
+pipe_close_end (struct pipe *pipe, bool write_end) {
+	lock_acquire (&pipe->lock);
+	if (write_end) {
+		ASSERT (pipe->writers > 0);
+		if (--pipe->writers == 0)
+			cond_broadcast (&pipe->not_empty, &pipe->lock);
+	} else {
+		ASSERT (pipe->readers > 0);
+		if (--pipe->readers == 0)
+			cond_broadcast (&pipe->not_full, &pipe->lock);
+	}
+	bool dead = pipe->readers == 0 && pipe->writers == 0;
+	lock_release (&pipe->lock);
+
+	if (dead) {
+		palloc_free_page (pipe->buf);
+		free (pipe);
+	}
+}
+
+/* Copies SIZE bytes between the ring of PIPE at free-running index
+ * POS and BUF, in at most two pieces.  TO_RING selects the
+ * direction. */
+static void
+pipe_copy (struct pipe *pipe, size_t pos, void *buf, size_t size,
+		bool to_ring) {
+	size_t ofs = pos % PIPE_SIZE;
+	size_t first = size < PIPE_SIZE - ofs ? size : PIPE_SIZE - ofs;
+
+	if (to_ring) {
+		memcpy (pipe->buf + ofs, buf, first);
+		memcpy (pipe->buf, (uint8_t *) buf + first, size - first);
+	} else {
+		memcpy (buf, pipe->buf + ofs, first);
+		memcpy ((uint8_t *) buf + first, pipe->buf, size - first);
+	}
+}
+
+/* Reads up to SIZE bytes from PIPE into BUFFER.  Waits until at least
+ * one byte is available, then takes whatever is there.  Returns the
+ * number of bytes read, which is 0 at end of file. */
+int
+pipe_read (struct pipe *pipe, void *buffer, size_t size) {
+	if (size == 0)
+		return 0;
+
+	lock_acquire (&pipe->lock);
+	while (pipe->tail == pipe->head && pipe->writers > 0)
+		cond_wait (&pipe->not_empty, &pipe->lock);
+
+	size_t avail = pipe->tail - pipe->head;
+	size_t n = size < avail ? size : avail;
+	pipe_copy (pipe, pipe->head, buffer, n, false);
+	pipe->head += n;
+	if (n > 0)
+		cond_broadcast (&pipe->not_full, &pipe->lock);
+	lock_release (&pipe->lock);
+	return n;
+}
+
+/* Writes SIZE bytes from BUFFER to PIPE, waiting for room as
+ * needed.  Returns the number of bytes written, which falls short
+ * only if the read end is closed part way through, or -1 if it was
+ * closed before anything was written. */
+int
+pipe_write (struct pipe *pipe, const void *buffer, size_t size) {
+	const uint8_t *src = buffer;
+	size_t written = 0;
+
+	lock_acquire (&pipe->lock);
+	while (written < size) {
+		while (pipe->tail - pipe->head == PIPE_SIZE && pipe->readers > 0)
+			cond_wait (&pipe->not_full, &pipe->lock);
+		if (pipe->readers == 0)
+			break;
+
+		size_t room = PIPE_SIZE - (pipe->tail - pipe->head);
+		size_t n = size - written < room ? size - written : room;
+		pipe_copy (pipe, pipe->tail, (void *) (src + written), n, true);
+		pipe->tail += n;
+		written += n;
+		cond_broadcast (&pipe->not_empty, &pipe->lock);
+	}
+	lock_release (&pipe->lock);
+	return written > 0 || size == 0 ? (int) written : -1;
+}
@@ -22,11 +22,15 @@
 #include "threads/synch.h"
 #include "threads/malloc.h"
 #include "intrinsic.h"
+#include <rusage.h>
 
 #ifdef VM
 #include "vm/vm.h"
 #endif
 
+/* If true, process_exit() reports the process's CPU usage. */
+bool process_rusage;
+
 static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *aux);
@@ -35,6 +39,7 @@ static void __do_fork (void *);
 static struct sync_to_parent *wait_status_create (void);
 static void wait_status_release (struct sync_to_parent *sync2p);
 static void add_child_wait_status (struct thread *parent, struct sync_to_parent *sync2p);
+static struct sync_to_parent *find_child_wait_status (struct thread *parent, tid_t child_tid);
 static struct sync_to_parent *remove_child_wait_status (struct thread *parent, tid_t child_tid);
 static void release_child_waits (struct thread *t);
 
@@ -45,23 +50,8 @@ struct initd_args {
 
 void
 init_fds (struct thread *target) {
-	if (!target->fds_initialized) {
-		list_init(&target->file_descriptors);
-		target->next_fd = 2;
-		target->fds_initialized = true;
-
-		struct file_descriptor *fd_stdin = malloc(sizeof(*fd_stdin));
-		fd_stdin->fd = 0;
-		fd_stdin->file = NULL;
-		fd_stdin->fd_kind = FD_STDIN;
-		list_push_back(&target->file_descriptors, &fd_stdin->elem);
-		
-		struct file_descriptor *fd_stdout = malloc(sizeof(*fd_stdout));
-		fd_stdout->fd = 1;
-		fd_stdout->file = NULL;
-		fd_stdout->fd_kind = FD_STDOUT;
-		list_push_back(&target->file_descriptors, &fd_stdout->elem);
-	}
+	if (!target->fds_initialized)
+		fd_table_init (target);
 }
 
 /*
@@ -118,20 +108,25 @@ add_child_wait_status (struct thread *parent, struct sync_to_parent *sync2p) {
 	list_push_back (&parent->children, &sync2p->elem);
 }
 
-/* remove the given child from the list */
+/* find the given child in the list */
 static struct sync_to_parent *
-remove_child_wait_status (struct thread *parent, tid_t child_tid) {
+find_child_wait_status (struct thread *parent, tid_t child_tid) {
 	if (!parent->children_initialized) return NULL;
 	for (struct list_elem *e = list_begin (&parent->children); e != list_end (&parent->children); e = list_next (e)) {
 		struct sync_to_parent *sync2p = list_entry (e, struct sync_to_parent, elem);
-		if (sync2p->child_tid == child_tid) {
-			list_remove (e);
-			return sync2p;
-		}
+		if (sync2p->child_tid == child_tid) return sync2p;
 	}
 	return NULL;
 }
 
+/* remove the given child from the list */
+static struct sync_to_parent *
+remove_child_wait_status (struct thread *parent, tid_t child_tid) {
+	struct sync_to_parent *sync2p = find_child_wait_status (parent, child_tid);
+	if (sync2p != NULL) list_remove (&sync2p->elem);
+	return sync2p;
+}
+
 /* edward: delist every child left on the list and decrease the following ref_cnt of the sync_to_parent struct object */
 static void
 release_child_waits (struct thread *t) {
@@ -299,7 +294,7 @@ duplicate_pte (uint64_t *pte, void *va, void *aux) {
 /*
 A thread function that copies parent's execution context.
 Hint)
-parent->tf does not hold the userland context of the process. 🔥
+The parent's saved kernel context does not hold the userland context of the process. 🔥
 That is, you are required to pass second argument of process_fork to this function.
 */
 static void
@@ -336,8 +331,15 @@ __do_fork (void *aux) {
 	if (!syscall_duplicate_fds (parent, current)) goto error;
 	current->stdin_cnt = parent->stdin_cnt;
 	current->stdout_cnt = parent->stdout_cnt;
+	current->batch_ring = parent->batch_ring; /* edward: same address, copied memory */
+	current->batch_entries = parent->batch_entries;
+#ifdef VM
+	current->heap_start = parent->heap_start;
+	current->brk = parent->brk;
+#endif
 	fs->success = true;
 	sema_up(&fs->semaphore); /* edward: wake parent up */
+	thread_acct_enter (ACCT_USER);
 	do_iret (&if_); /* Finally, switch to the newly created process. */
 error:
 	fs->success = false;
@@ -363,6 +365,7 @@ process_exec (void *f_name) {
 	_if.eflags = FLAG_IF | FLAG_MBS;
 
 	process_cleanup (); /* We first kill the current context */
+	thread_current ()->batch_ring = NULL;
 #ifdef VM
 	supplemental_page_table_init(&thread_current()->spt);
 #endif
@@ -373,6 +376,7 @@ process_exec (void *f_name) {
 		thread_current ()->exit_status = -1;
 		thread_exit (); /* If load failed, terminate the process. */
 	}
+	thread_acct_enter (ACCT_USER);
 	do_iret (&_if); /* Start switched process. */
 	NOT_REACHED ();
 }
@@ -399,6 +403,25 @@ process_wait (tid_t child_tid) {
 	return status;
 }
 
+/*
+Like process_wait(), but gives up after TIMEOUT timer ticks.
+Returns 0 after storing the child's exit status in *STATUS, 1 if the
+child is still running at the deadline (it stays waitable), or -1 if
+CHILD_TID cannot be waited for.
+*/
+int
+process_wait_timeout (tid_t child_tid, int64_t timeout, int *status) {
+	struct sync_to_parent *sync2p = find_child_wait_status (thread_current (), child_tid);
+	if (sync2p == NULL) return -1;
+	if (!sema_down_timeout (&sync2p->sema, timeout)) return 1;
+	list_remove (&sync2p->elem);
+	lock_acquire (&sync2p->lock);
+	*status = sync2p->exit_code;
+	lock_release (&sync2p->lock);
+	wait_status_release (sync2p);
+	return 0;
+}
+
 /*
 Exit the process.
 This function is called by thread_exit ().
@@ -407,8 +430,9 @@ void
 process_exit (void) {
 	/*
 	uint64_t *pml4;
-	struct list file_descriptors;
-	int next_fd;
+	struct file_descriptor *fd_table;
+	uint64_t *fd_map;
+	size_t fd_cap;
 	bool fds_initialized;
 	struct list children;
 	bool children_initialized;
@@ -416,6 +440,13 @@ process_exit (void) {
 	*/
 	struct thread *curr = thread_current ();
 	if (curr->pml4 != NULL) printf ("%s: exit(%d)\n", curr->name, curr->exit_status);
+	if (curr->pml4 != NULL && process_rusage) {
+		struct rusage ru;
+		thread_get_rusage (&ru);
+		printf ("%s: rusage user %"PRId64"us sys %"PRId64"us fault %"PRId64"us iowait %"PRId64"us\n",
+				curr->name, ru.ru_utime / 1000, ru.ru_stime / 1000,
+				ru.ru_ftime / 1000, ru.ru_iotime / 1000);
+	}
 
 	release_child_waits (curr);
 	if (curr->sync2p != NULL) {
@@ -577,6 +608,9 @@ load (const char *file_name, struct intr_frame *if_) {
 	if (t->pml4 == NULL)
 		goto done;
 	process_activate (thread_current ());
+#ifdef VM
+	t->heap_start = t->brk = NULL;
+#endif
 
 	/* edward: open requested ELF file. */
 	file = filesys_open (argv[0]); /* test 46 fails.. */
@@ -642,6 +676,12 @@ load (const char *file_name, struct intr_frame *if_) {
 						zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
 					}
 					if (!load_segment (file, file_page, (void *) mem_page, read_bytes, zero_bytes, writable)) goto done;
+#ifdef VM
+					/* edward: the heap starts above the highest segment */
+					void *seg_end = (void *) (mem_page + read_bytes + zero_bytes);
+					if (seg_end > t->heap_start)
+						t->heap_start = t->brk = seg_end;
+#endif
 				}
 				else goto done;
 				break;
@@ -857,9 +897,7 @@ lazy_load_segment (struct page *page, void *aux) {
 	/* TODO: This called when the first page fault occurs on address VA. */
 	void *kva = page->frame->kva;
 
-	lock_acquire (&filesys_lock);
 	int bytes_read = file_read_at (load_aux ->file, kva, load_aux ->read_bytes, load_aux ->ofs);
-	lock_release (&filesys_lock);
 
 	if (bytes_read != (int) load_aux ->read_bytes) {
 		free (load_aux);
@@ -3,13 +3,22 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <string.h>
+#include <limits.h>
+#include <round.h>
 #include <syscall-nr.h>
+#include <uio.h>
+#include <syscall-batch.h>
+#include <rusage.h>
+#include "devices/disk.h"
+#include "devices/hrtimer.h"
 #include "devices/input.h"
+#include "devices/timer.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/init.h"
+#include "threads/ktrace.h"
 #include "threads/loader.h"
 #include "threads/vaddr.h"
 #include "threads/mmu.h"
@@ -17,6 +26,8 @@
 #include "threads/synch.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "userprog/futex.h"
+#include "userprog/pipe.h"
 #include "userprog/process.h"
 #include "vm/vm.h"
 #include "intrinsic.h"
@@ -24,8 +35,6 @@
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
 
-struct lock filesys_lock;
-
 /* System call.
  *
  * Previously system call services was handled by the interrupt handler
@@ -43,13 +52,18 @@ static void halt_handler (void) NO_RETURN;
 static void exit_handler (int status) NO_RETURN;
 static void exit_with_error (void) NO_RETURN;
 static int64_t get_user (const uint8_t *uaddr);
-static bool put_user (uint8_t *udst, uint8_t byte);
-static void validate_user_buffer (const void *buffer, size_t size, bool writable);
-static void validate_user_string (const char *str);
+static bool user_memcpy (void *dst, const void *src, size_t size);
+static bool user_range_writable (void *uaddr, size_t size);
+
+/* The instructions in get_user() and user_memcpy() that may fault on
+   a user address.  See user_access_fixup(). */
+extern const char get_user_insn[], user_memcpy_insn[];
+static bool is_user_range (const void *uaddr, size_t size);
 static char *copy_user_string (const char *str);
 static struct file_descriptor *fd_lookup (int fd);
 static int allocate_fd (struct file *file);
-static void close_fd (struct file_descriptor *desc);
+static int allocate_pipe_fd (struct pipe *pipe, enum fd_kind kind);
+static void close_fd (struct thread *t, int fd);
 static int fork_handler (const char *name, struct intr_frame *f);
 static int exec_handler (const char *cmd_line);
 static bool create_handler (const char *file, unsigned initial_size);
@@ -57,12 +71,27 @@ static bool remove_handler (const char *file);
 static int open_handler (const char *file);
 static int filesize_handler (int fd);
 static int read_handler (int fd, void *buffer, unsigned length);
+static int readv_handler (int fd, const struct iovec *uiov, int iovcnt);
+static int writev_handler (int fd, const struct iovec *uiov, int iovcnt);
+static int pread_handler (int fd, void *buffer, unsigned length, off_t offset);
+static int pwrite_handler (int fd, const void *buffer, unsigned length, off_t offset);
+static int sendfile_handler (int out_fd, int in_fd, unsigned length);
+static int batch_setup_handler (struct batch_ring *ring, unsigned entries);
+static int batch_enter_handler (void);
+static int pipe_handler (int *fds);
+static int getrusage_handler (struct rusage *usage);
+static int futex_wait_handler (int *addr, int val);
+static int wait_timeout_handler (tid_t tid, int ms, int *status);
+static int futex_wake_handler (int *addr, int count);
+#ifdef VM
+static void *shm_map_handler (const char *name, void *addr, size_t length);
+static bool shm_unlink_handler (const char *name);
+#endif
 static void seek_handler (int fd, unsigned position);
 static unsigned tell_handler (int fd);
 static void close_handler (int fd);
 static void close_all_files (struct thread *t);
 int dup2_handler (int oldfd, int newfd);
-void update_fduplicated(struct thread *thread, bool b_value);
 
 void
 syscall_init (void) {
@@ -74,7 +103,7 @@ syscall_init (void) {
 	 * until the syscall_entry swaps the userland stack to the kernel
 	 * mode stack. Therefore, we masked the FLAG_FL. */
 	write_msr(MSR_SYSCALL_MASK, FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
-	lock_init (&filesys_lock);
+	futex_init ();
 }
 
 /* The main system call interface */
@@ -83,6 +112,8 @@ syscall_handler (struct intr_frame *f) {
 	// user rsp 백업 
 	struct thread *curr = thread_current();
   curr->user_rsp = f->rsp;
+	thread_acct_enter (ACCT_SYS);
+	KTRACE_EVENT (KT_SYSCALL, 0, f->R.rax);
 	
 	switch (f->R.rax)
 	{
@@ -131,33 +162,120 @@ syscall_handler (struct intr_frame *f) {
 	case SYS_DUP2:
 		f->R.rax = dup2_handler((int) f->R.rdi, (int) f->R.rsi);
 		break;
+	case SYS_READV:
+		f->R.rax = readv_handler ((int) f->R.rdi, (const struct iovec *) f->R.rsi, (int) f->R.rdx);
+		break;
+	case SYS_WRITEV:
+		f->R.rax = writev_handler ((int) f->R.rdi, (const struct iovec *) f->R.rsi, (int) f->R.rdx);
+		break;
+	case SYS_PREAD:
+		f->R.rax = pread_handler ((int) f->R.rdi, (void *) f->R.rsi, (unsigned) f->R.rdx, (off_t) f->R.r10);
+		break;
+	case SYS_PWRITE:
+		f->R.rax = pwrite_handler ((int) f->R.rdi, (const void *) f->R.rsi, (unsigned) f->R.rdx, (off_t) f->R.r10);
+		break;
+	case SYS_SENDFILE:
+		f->R.rax = sendfile_handler ((int) f->R.rdi, (int) f->R.rsi, (unsigned) f->R.rdx);
+		break;
+	case SYS_BATCH_SETUP:
+		f->R.rax = batch_setup_handler ((struct batch_ring *) f->R.rdi, (unsigned) f->R.rsi);
+		break;
+	case SYS_BATCH_ENTER:
+		f->R.rax = batch_enter_handler ();
+		break;
+	case SYS_PIPE:
+		f->R.rax = pipe_handler ((int *) f->R.rdi);
+		break;
+	case SYS_NANOSLEEP:
+		if ((int64_t) f->R.rdi < 0)
+			f->R.rax = -1;
+		else {
+			hrtimer_sleep ((int64_t) f->R.rdi);
+			f->R.rax = 0;
+		}
+		break;
+	case SYS_GETRUSAGE:
+		f->R.rax = getrusage_handler ((struct rusage *) f->R.rdi);
+		break;
+	case SYS_WAIT_TIMEOUT:
+		f->R.rax = wait_timeout_handler ((tid_t) f->R.rdi, (int) f->R.rsi, (int *) f->R.rdx);
+		break;
+	case SYS_FUTEX_WAIT:
+		f->R.rax = futex_wait_handler ((int *) f->R.rdi, (int) f->R.rsi);
+		break;
+	case SYS_FUTEX_WAKE:
+		f->R.rax = futex_wake_handler ((int *) f->R.rdi, (int) f->R.rsi);
+		break;
+#ifdef VM
+	case SYS_SHM_MAP:
+		f->R.rax = (uint64_t) shm_map_handler ((const char *) f->R.rdi, (void *) f->R.rsi, (size_t) f->R.rdx);
+		break;
+	case SYS_SHM_UNMAP:
+		anon_shared_unmap ((void *) f->R.rdi);
+		break;
+	case SYS_SHM_UNLINK:
+		f->R.rax = shm_unlink_handler ((const char *) f->R.rdi);
+		break;
+	case SYS_SBRK:
+		f->R.rax = (uint64_t) vm_sbrk ((intptr_t) f->R.rdi);
+		break;
+	case SYS_MADVISE:
+		f->R.rax = vm_madvise ((void *) f->R.rdi, (size_t) f->R.rsi, (int) f->R.rdx) ? 0 : -1;
+		break;
+#endif
 	default:
 		exit_with_error ();
 	}
+	KTRACE_EVENT (KT_SYSRET, f->R.rax, 0);
+	thread_acct_enter (ACCT_USER);
 }
 
 int
 write_handler (int fd, const void *buffer, unsigned length) {
 	if (fd < 0) return -1;
 	if (length == 0) return 0;
-	
+	if (!is_user_range (buffer, length)) exit_with_error ();
+
 	struct file_descriptor *desc = fd_lookup (fd);
 	if (!desc) return -1;
-	if (desc->file) {
-		validate_user_buffer (buffer, length, desc->file->deny_write);
-	}
-	
-	if (!desc->file) { /* STDIN, STDOUT */
+	if (desc->fd_kind == FD_PIPE_READ) return -1;
+	if (!desc->file && desc->fd_kind != FD_PIPE_WRITE) { /* STDIN, STDOUT */
 		if (desc->fd_kind == FD_STDIN) return -1;
-		if (desc->fd_kind == FD_STDOUT) {
-			if (thread_current()->stdout_cnt == 0) return -1;
-			putbuf (buffer, length);
-			return (int) length;
+		if (desc->fd_kind == FD_STDOUT && thread_current()->stdout_cnt == 0) return -1;
+	}
+
+	/* edward: stage through a kernel page so that no user page is
+	   faulted in while the file system (or console) is busy. */
+	uint8_t *bounce = palloc_get_page (0);
+	if (bounce == NULL) return -1;
+
+	const uint8_t *src = buffer;
+	int result = 0;
+	while (length > 0) {
+		size_t chunk = length < PGSIZE ? length : PGSIZE;
+		if (!copy_from_user (bounce, src + result, chunk)) {
+			palloc_free_page (bounce);
+			exit_with_error ();
+		}
+
+		int written;
+		if (desc->fd_kind == FD_PIPE_WRITE) {
+			written = pipe_write (desc->pipe, bounce, chunk);
+			if (written < 0) {
+				if (result == 0) result = -1;
+				break;
+			}
+		} else if (!desc->file) {
+			putbuf ((const char *) bounce, chunk);
+			written = chunk;
+		} else {
+			written = file_write (desc->file, bounce, chunk);
 		}
+		result += written;
+		length -= written;
+		if ((size_t) written < chunk) break;
 	}
-	lock_acquire (&filesys_lock);
-	int result = file_write (desc->file, buffer, length);
-	lock_release (&filesys_lock);
+	palloc_free_page (bounce);
 	return result;
 }
 
@@ -165,26 +283,468 @@ static int
 read_handler (int fd, void *buffer, unsigned length) {
 	if (fd < 0) return -1;
 	if (length == 0) return 0;
-	validate_user_buffer (buffer, length, true);
+	if (!is_user_range (buffer, length)) exit_with_error ();
 
 	struct file_descriptor *desc = fd_lookup (fd);
 	if (desc == NULL) return -1;
-	if (desc->file == NULL) {
+	if (desc->fd_kind == FD_PIPE_WRITE) return -1;
+	if (desc->file == NULL && desc->fd_kind != FD_PIPE_READ) {
 		if (desc->fd_kind == FD_STDOUT) return -1;
-		if (desc->fd_kind == FD_STDIN) {
-			if (thread_current()->stdin_cnt == 0) return -1;
-			uint8_t *dst = buffer;
-			for (unsigned i = 0; i < length; i++) dst[i] = input_getc ();
-			return (int) length;
+		if (desc->fd_kind == FD_STDIN && thread_current()->stdin_cnt == 0) return -1;
+	}
+
+	uint8_t *bounce = palloc_get_page (0);
+	if (bounce == NULL) return -1;
+
+	uint8_t *dst = buffer;
+	int result = 0;
+	while (length > 0) {
+		size_t chunk = length < PGSIZE ? length : PGSIZE;
+		int bytes_read;
+		if (desc->fd_kind == FD_PIPE_READ) {
+			bytes_read = pipe_read (desc->pipe, bounce, chunk);
+		} else if (desc->file == NULL) {
+			for (size_t i = 0; i < chunk; i++) bounce[i] = input_getc ();
+			bytes_read = chunk;
+		} else {
+			bytes_read = file_read (desc->file, bounce, chunk);
+		}
+
+		if (!copy_to_user (dst + result, bounce, bytes_read)) {
+			palloc_free_page (bounce);
+			exit_with_error ();
+		}
+		result += bytes_read;
+		length -= bytes_read;
+		/* edward: a pipe hands over what it has; don't wait for more. */
+		if ((size_t) bytes_read < chunk || desc->fd_kind == FD_PIPE_READ) break;
+	}
+	palloc_free_page (bounce);
+	return result;
+}
+
+/* edward: vectored and positional I/O.  The iovec array is copied in
+   and checked once up front.  File data then moves through one bounce
+   page per PGSIZE bytes no matter how the caller split it up, so a run
+   of small iovecs costs one file_read_at/file_write_at per page rather
+   than one read/write syscall per element. */
+
+/* Returned by vector_io() when a user buffer could not be accessed. */
+#define VIO_FAULT (-2)
+
+/* Copies the user iovec array UIOV of IOVCNT entries into a new
+   kernel array, stores the sum of its lengths in *TOTAL and returns
+   the array, which the caller must free().  Returns NULL if IOVCNT or
+   the total is out of range.  Kills the process if UIOV or any buffer
+   it names lies outside user memory. */
+static struct iovec *
+copy_iovec_from_user (const struct iovec *uiov, int iovcnt, size_t *total) {
+	if (iovcnt <= 0 || iovcnt > IOV_MAX) return NULL;
+
+	struct iovec *iov = malloc (iovcnt * sizeof *iov);
+	if (iov == NULL) return NULL;
+	if (!copy_from_user (iov, uiov, iovcnt * sizeof *iov)) {
+		free (iov);
+		exit_with_error ();
+	}
+
+	*total = 0;
+	for (int i = 0; i < iovcnt; i++) {
+		if (!is_user_range (iov[i].iov_base, iov[i].iov_len)) {
+			free (iov);
+			exit_with_error ();
+		}
+		if (iov[i].iov_len > INT_MAX || *total + iov[i].iov_len > INT_MAX) {
+			free (iov);
+			return NULL;
+		}
+		*total += iov[i].iov_len;
+	}
+	return iov;
+}
+
+/* Copies SIZE bytes between BUF and the iovecs in IOV, continuing at
+   element *IDX, byte *OFS, and advances the cursor.  TO_USER selects
+   the direction.  Returns false if a user buffer is not accessible. */
+static bool
+iov_copy (const struct iovec *iov, int *idx, size_t *ofs,
+		uint8_t *buf, size_t size, bool to_user) {
+	while (size > 0) {
+		const struct iovec *v = &iov[*idx];
+		size_t n = v->iov_len - *ofs;
+		if (n > size) n = size;
+
+		uint8_t *ubuf = (uint8_t *) v->iov_base + *ofs;
+		if (!(to_user ? copy_to_user (ubuf, buf, n) : copy_from_user (buf, ubuf, n)))
+			return false;
+		buf += n;
+		size -= n;
+		*ofs += n;
+		if (*ofs == v->iov_len) {
+			(*idx)++;
+			*ofs = 0;
+		}
+	}
+	return true;
+}
+
+/* Moves TOTAL bytes between descriptor FD and the user buffers in the
+   kernel iovec array IOV.  Files are accessed at OFFSET, or at and
+   past their current position if OFFSET is negative.  WRITE selects
+   the direction.  Returns the number of bytes moved, -1 on error, or
+   VIO_FAULT if a user buffer turned out to be inaccessible. */
+static int
+vector_io (int fd, const struct iovec *iov, size_t total,
+		off_t offset, bool write) {
+	struct file_descriptor *desc = fd_lookup (fd);
+	if (desc == NULL) return -1;
+	if (desc->file == NULL) {
+		struct thread *curr = thread_current ();
+		if (offset >= 0) return -1;
+		if (FD_IS_PIPE (desc->fd_kind)) {
+			if (desc->fd_kind != (write ? FD_PIPE_WRITE : FD_PIPE_READ)) return -1;
 		}
+		else if (write && (desc->fd_kind != FD_STDOUT || curr->stdout_cnt == 0)) return -1;
+		else if (!write && (desc->fd_kind != FD_STDIN || curr->stdin_cnt == 0)) return -1;
+	}
+	if (total == 0) return 0;
+
+	uint8_t *bounce = palloc_get_page (0);
+	if (bounce == NULL) return -1;
+
+	off_t pos = 0;
+	if (desc->file != NULL)
+		pos = offset < 0 ? file_tell (desc->file) : offset;
+
+	int idx = 0;
+	size_t ofs = 0;
+	int result = 0;
+	while ((size_t) result < total) {
+		size_t chunk = total - result < PGSIZE ? total - result : PGSIZE;
+		int moved;
+		if (write) {
+			if (!iov_copy (iov, &idx, &ofs, bounce, chunk, false)) {
+				result = VIO_FAULT;
+				break;
+			}
+			if (desc->fd_kind == FD_PIPE_WRITE) {
+				moved = pipe_write (desc->pipe, bounce, chunk);
+				if (moved < 0) {
+					if (result == 0) result = -1;
+					break;
+				}
+			} else if (desc->file == NULL) {
+				putbuf ((const char *) bounce, chunk);
+				moved = chunk;
+			} else {
+				moved = file_write_at (desc->file, bounce, chunk, pos);
+			}
+		} else {
+			if (desc->fd_kind == FD_PIPE_READ) {
+				moved = pipe_read (desc->pipe, bounce, chunk);
+			} else if (desc->file == NULL) {
+				for (size_t i = 0; i < chunk; i++) bounce[i] = input_getc ();
+				moved = chunk;
+			} else {
+				moved = file_read_at (desc->file, bounce, chunk, pos);
+			}
+			if (!iov_copy (iov, &idx, &ofs, bounce, moved, true)) {
+				result = VIO_FAULT;
+				break;
+			}
+		}
+		pos += moved;
+		result += moved;
+		if ((size_t) moved < chunk || desc->fd_kind == FD_PIPE_READ) break;
+	}
+	palloc_free_page (bounce);
+
+	if (result != VIO_FAULT && desc->file != NULL && offset < 0)
+		file_seek (desc->file, pos);
+	return result;
+}
+
+static int
+readv_handler (int fd, const struct iovec *uiov, int iovcnt) {
+	size_t total;
+	struct iovec *iov = copy_iovec_from_user (uiov, iovcnt, &total);
+	if (iov == NULL) return -1;
+
+	int result = vector_io (fd, iov, total, -1, false);
+	free (iov);
+	if (result == VIO_FAULT) exit_with_error ();
+	return result;
+}
+
+static int
+writev_handler (int fd, const struct iovec *uiov, int iovcnt) {
+	size_t total;
+	struct iovec *iov = copy_iovec_from_user (uiov, iovcnt, &total);
+	if (iov == NULL) return -1;
+
+	int result = vector_io (fd, iov, total, -1, true);
+	free (iov);
+	if (result == VIO_FAULT) exit_with_error ();
+	return result;
+}
+
+static int
+pread_handler (int fd, void *buffer, unsigned length, off_t offset) {
+	if (offset < 0 || length > INT_MAX) return -1;
+	if (!is_user_range (buffer, length)) exit_with_error ();
+
+	struct iovec iov = { buffer, length };
+	int result = vector_io (fd, &iov, length, offset, false);
+	if (result == VIO_FAULT) exit_with_error ();
+	return result;
+}
+
+static int
+pwrite_handler (int fd, const void *buffer, unsigned length, off_t offset) {
+	if (offset < 0 || length > INT_MAX) return -1;
+	if (!is_user_range (buffer, length)) exit_with_error ();
+
+	struct iovec iov = { (void *) buffer, length };
+	int result = vector_io (fd, &iov, length, offset, true);
+	if (result == VIO_FAULT) exit_with_error ();
+	return result;
+}
+
+/* Copies up to LENGTH bytes from file IN_FD to OUT_FD, which may be
+   a file or the console, starting at and advancing both current
+   positions.  The data never passes through user memory.  Reads are
+   kept sector-aligned in the input file so that inode_read_at() can
+   move whole sectors straight into the staging page.  Returns the
+   number of bytes copied, or -1 on error. */
+static int
+sendfile_handler (int out_fd, int in_fd, unsigned length) {
+	struct file_descriptor *in = fd_lookup (in_fd);
+	struct file_descriptor *out = fd_lookup (out_fd);
+	if (in == NULL || out == NULL || in->file == NULL) return -1;
+	if (out->file == NULL && out->fd_kind != FD_PIPE_WRITE
+			&& (out->fd_kind != FD_STDOUT || thread_current ()->stdout_cnt == 0))
+		return -1;
+	if (length > INT_MAX) length = INT_MAX;
+	if (length == 0) return 0;
+
+	uint8_t *bounce = palloc_get_page (0);
+	if (bounce == NULL) return -1;
+
+	int result = 0;
+	while ((unsigned) result < length) {
+		size_t chunk = PGSIZE - file_tell (in->file) % DISK_SECTOR_SIZE;
+		if (chunk > length - result) chunk = length - result;
+
+		int bytes_read = file_read (in->file, bounce, chunk);
+		if (bytes_read <= 0) break;
+
+		int written;
+		if (out->fd_kind == FD_PIPE_WRITE) {
+			written = pipe_write (out->pipe, bounce, bytes_read);
+			if (written < 0) written = 0;
+		} else if (out->file == NULL) {
+			putbuf ((const char *) bounce, bytes_read);
+			written = bytes_read;
+		} else {
+			written = file_write (out->file, bounce, bytes_read);
+		}
+		result += written;
+
+		/* Give back what the output side did not take. */
+		if (written < bytes_read) {
+			file_seek (in->file, file_tell (in->file) - (bytes_read - written));
+			break;
+		}
+		if ((size_t) bytes_read < chunk) break;
+	}
+	palloc_free_page (bounce);
+	return result;
+}
+
+/* edward: batched syscalls.  The ring is plain user memory, so the
+   kernel reaches it only through copy_from_user()/copy_to_user() and
+   trusts nothing in it but the indices, which it checks.  Entries run
+   in the calling thread inside batch_enter(), which returns once they
+   are all done; what a batch saves is one trap per entry. */
+
+/* Registers the ring at RING with ENTRIES entries for the current
+   process, or unregisters the current ring if RING is NULL.  Resets
+   the ring's indices.  Returns 0 if successful, -1 otherwise. */
+static int
+batch_setup_handler (struct batch_ring *ring, unsigned entries) {
+	struct thread *curr = thread_current ();
+
+	if (ring == NULL) {
+		curr->batch_ring = NULL;
+		return 0;
+	}
+	if (entries == 0 || entries > BATCH_MAX || (entries & (entries - 1)))
+		return -1;
+	if (!is_user_range (ring, BATCH_RING_SIZE (entries))) return -1;
+
+	struct batch_ring header = { .entries = entries };
+	if (!copy_to_user (ring, &header, sizeof header)) exit_with_error ();
+	curr->batch_ring = ring;
+	curr->batch_entries = entries;
+	return 0;
+}
+
+/* Runs one submission and returns its result. */
+static int64_t
+batch_dispatch (const struct batch_sqe *sqe) {
+	void *addr = (void *) sqe->addr;
+
+	switch (sqe->op) {
+	case BATCH_NOP:
+		return 0;
+	case BATCH_READ:
+		if (sqe->offset < 0)
+			return read_handler (sqe->fd, addr, sqe->len);
+		return pread_handler (sqe->fd, addr, sqe->len, sqe->offset);
+	case BATCH_WRITE:
+		if (sqe->offset < 0)
+			return write_handler (sqe->fd, addr, sqe->len);
+		return pwrite_handler (sqe->fd, addr, sqe->len, sqe->offset);
+	case BATCH_OPEN:
+		return open_handler (addr);
+	case BATCH_CLOSE:
+		if (fd_lookup (sqe->fd) == NULL) return -1;
+		close_handler (sqe->fd);
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+/* Runs every submission queued on the current process's ring, in
+   order, for as long as there is room for the completions.  Returns
+   the number of submissions run, or -1 if no ring is registered or
+   its indices are corrupt. */
+static int
+batch_enter_handler (void) {
+	struct thread *curr = thread_current ();
+	struct batch_ring *ring = curr->batch_ring;
+	if (ring == NULL) return -1;
+
+	uint32_t entries = curr->batch_entries;
+	struct batch_sqe *sq = (struct batch_sqe *) (ring + 1);
+	struct batch_cqe *cq = (struct batch_cqe *) (sq + entries);
+
+	struct batch_ring idx;
+	if (!copy_from_user (&idx, ring, sizeof idx)) exit_with_error ();
+	if (idx.sq_tail - idx.sq_head > entries || idx.cq_tail - idx.cq_head > entries)
+		return -1;
+
+	int done = 0;
+	while (idx.sq_head != idx.sq_tail && idx.cq_tail - idx.cq_head < entries) {
+		struct batch_sqe sqe;
+		if (!copy_from_user (&sqe, &sq[idx.sq_head & (entries - 1)], sizeof sqe))
+			exit_with_error ();
+
+		struct batch_cqe cqe = { sqe.user_data, batch_dispatch (&sqe) };
+		if (!copy_to_user (&cq[idx.cq_tail & (entries - 1)], &cqe, sizeof cqe))
+			exit_with_error ();
+		idx.sq_head++;
+		idx.cq_tail++;
+		done++;
+	}
+
+	if (!copy_to_user (&ring->sq_head, &idx.sq_head, sizeof idx.sq_head)
+			|| !copy_to_user (&ring->cq_tail, &idx.cq_tail, sizeof idx.cq_tail))
+		exit_with_error ();
+	return done;
+}
+
+/* Creates a pipe and stores its read and write descriptors in FDS[0]
+   and FDS[1].  Returns 0 if successful, -1 otherwise. */
+static int
+pipe_handler (int *ufds) {
+	struct thread *curr = thread_current ();
+	int fds[2];
+
+	if (!is_user_range (ufds, sizeof fds)) exit_with_error ();
+	if (!curr->fds_initialized) return -1;
+
+	struct pipe *pipe = pipe_create ();
+	if (pipe == NULL) return -1;
+
+	fds[0] = allocate_pipe_fd (pipe, FD_PIPE_READ);
+	if (fds[0] < 0) {
+		pipe_close_end (pipe, false);
+		pipe_close_end (pipe, true);
+		return -1;
 	}
+	fds[1] = allocate_pipe_fd (pipe, FD_PIPE_WRITE);
+	if (fds[1] < 0) {
+		close_fd (curr, fds[0]);
+		pipe_close_end (pipe, true);
+		return -1;
+	}
+
+	/* edward: on a bad FDS both ends are closed on the way out. */
+	if (!copy_to_user (ufds, fds, sizeof fds)) exit_with_error ();
+	return 0;
+}
+
+static int
+getrusage_handler (struct rusage *uusage) {
+	struct rusage usage;
+
+	if (!is_user_range (uusage, sizeof usage)) exit_with_error ();
+	thread_get_rusage (&usage);
+	if (!copy_to_user (uusage, &usage, sizeof usage)) exit_with_error ();
+	return 0;
+}
+
+/* edward: MS is rounded up to whole timer ticks. */
+static int
+wait_timeout_handler (tid_t tid, int ms, int *ustatus) {
+	int status;
+
+	if (!is_user_range (ustatus, sizeof status)) exit_with_error ();
+	if (ms < 0) return -1;
+	int result = process_wait_timeout (tid, DIV_ROUND_UP ((int64_t) ms * TIMER_FREQ, 1000), &status);
+	if (result == 0 && !copy_to_user (ustatus, &status, sizeof status)) exit_with_error ();
+	return result;
+}
+
+/* edward: a futex word must be an aligned int in user memory. */
+static int
+futex_wait_handler (int *addr, int val) {
+	if ((uintptr_t) addr % sizeof *addr != 0 || !is_user_range (addr, sizeof *addr))
+		exit_with_error ();
+	int result = futex_wait (addr, val);
+	if (result == FUTEX_FAULT) exit_with_error ();
+	return result;
+}
+
+static int
+futex_wake_handler (int *addr, int count) {
+	if ((uintptr_t) addr % sizeof *addr != 0 || !is_user_range (addr, sizeof *addr))
+		exit_with_error ();
+	return count > 0 ? futex_wake (addr, count) : 0;
+}
 
-	lock_acquire (&filesys_lock);
-	int result = file_read (desc->file, buffer, length);
-	lock_release (&filesys_lock);
+#ifdef VM
+static void *
+shm_map_handler (const char *name, void *addr, size_t length) {
+	char *name_copy = NULL;
+	if (name != NULL && (name_copy = copy_user_string (name)) == NULL) return NULL;
+	void *result = anon_shared_map (addr, length, name_copy);
+	if (name_copy != NULL) palloc_free_page (name_copy);
 	return result;
 }
 
+static bool
+shm_unlink_handler (const char *name) {
+	char *name_copy = copy_user_string (name);
+	if (name_copy == NULL) return false;
+	bool success = anon_shared_unlink (name_copy);
+	palloc_free_page (name_copy);
+	return success;
+}
+#endif
+
 static void
 halt_handler (void) {
 	power_off ();
@@ -209,81 +769,122 @@ get_user (const uint8_t *uaddr) {
 	int64_t result;
 	__asm __volatile (
 		"movabsq $done_get, %0\n"
+		"get_user_insn:\n"
 		"movzbq %1, %0\n"
 		"done_get:\n"
 		: "=&a" (result) : "m" (*uaddr));
 	return result;
 }
 
-/* Writes BYTE to user address UDST.
-   Returns true if successful, false if a segfault occurred. */
+/* Copies SIZE bytes from SRC to DST, where one side is a user
+   address that page_fault() may have to bring in.  Uses the same
+   recovery protocol as get_user(): the resume address sits in rax
+   and page_fault() stores -1 there if the access cannot be
+   satisfied.  Returns true if successful, false if a segfault
+   occurred. */
 static bool
-put_user (uint8_t *udst, uint8_t byte) {
-	int64_t error_code;
+user_memcpy (void *dst, const void *src, size_t size) {
+	int64_t status;
 	__asm __volatile (
-		"movabsq $done_put, %0\n"
-		"movb %b2, %1\n"
-		"done_put:\n"
-		: "=&a" (error_code), "=m" (*udst) : "q" (byte));
-	return error_code != -1;
+		"movabsq $1f, %0\n"
+		"user_memcpy_insn:\n"
+		"rep movsb\n"
+		"1:\n"
+		: "=&a" (status), "+D" (dst), "+S" (src), "+c" (size)
+		: : "memory");
+	return status != -1;
 }
 
-static void
-validate_user_buffer (const void *buffer, size_t size, bool writable) {
-	if (size == 0) return;
-
-	const uint8_t *addr = buffer;
-	struct thread *curr = thread_current();
-	uintptr_t rsp = curr->user_rsp;
+/* Called by page_fault() for a kernel-mode fault it could not
+   resolve.  If F faulted in get_user() or user_memcpy(), resumes it
+   at the address the helper left in rax, with -1 in rax, and returns
+   true.  Returns false for any other fault, which is a kernel bug. */
+bool
+user_access_fixup (struct intr_frame *f) {
+	if (f->rip != (uintptr_t) get_user_insn && f->rip != (uintptr_t) user_memcpy_insn)
+		return false;
+	f->rip = f->R.rax;
+	f->R.rax = -1;
+	return true;
+}
 
-	while (size > 0) {
-		if (!is_user_vaddr((void *)addr)) {
-			exit_with_error ();
-		}
+/* Returns true if no page of [UADDR, UADDR + SIZE) is mapped
+   read-only.  CR0.WP is clear, so a kernel store into a present
+   read-only user page would not fault; a page not yet mapped is
+   checked by vm_try_handle_fault() when the store brings it in. */
+static bool
+user_range_writable (void *uaddr, size_t size) {
+	uint64_t *pml4 = thread_current ()->pml4;
+	uintptr_t end = (uintptr_t) uaddr + size;
+	for (uintptr_t va = (uintptr_t) pg_round_down (uaddr); va < end; va += PGSIZE) {
+		uint64_t *pte = pml4e_walk (pml4, va, 0);
+		if (pte != NULL && (*pte & PTE_P) && !is_writable (pte))
+			return false;
+	}
+	return true;
+}
 
-		struct page *page = spt_find_page(&curr->spt, (void *)addr);
-		if (!page) {
-			if (!(addr <= (uint8_t *)USER_STACK && addr >= (uint8_t *)USER_STACK - STACK_LIMIT && rsp - 8 <= (uintptr_t)addr)) {
-				exit_with_error ();
-			}
-		} else if (writable && !page->writable) {
-			exit_with_error ();
-		}
+/* Returns true if [UADDR, UADDR + SIZE) lies entirely below
+   KERN_BASE.  Whether the pages are actually mapped is left to
+   the page fault handler. */
+static bool
+is_user_range (const void *uaddr, size_t size) {
+	uintptr_t start = (uintptr_t) uaddr;
+	uintptr_t end = start + size;
+	return end >= start && (size == 0 || is_user_vaddr ((void *) (end - 1)));
+}
 
-		int64_t byte = get_user(addr);
-		if (byte == -1) {
-			exit_with_error ();
-		}
-		if (writable && !put_user((uint8_t *)addr, (uint8_t)byte)) {
-			exit_with_error ();
-		}
+/* Copies SIZE bytes from user address USRC into kernel buffer DST.
+   Returns false if any byte of the source is not readable. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size) {
+	if (!is_user_range (usrc, size)) return false;
+	return user_memcpy (dst, usrc, size);
+}
 
-		size_t advance = PGSIZE - pg_ofs(addr);
-		if (advance > size) {
-			advance = size;
-		}
-		addr += advance;
-		size -= advance;
-	}
+/* Copies SIZE bytes from kernel buffer SRC to user address UDST.
+   Returns false if any byte of the destination is not writable. */
+bool
+copy_to_user (void *udst, const void *src, size_t size) {
+	if (!is_user_range (udst, size) || !user_range_writable (udst, size)) return false;
+	return user_memcpy (udst, src, size);
 }
 
-static void
-validate_user_string (const char *str) {
-	if (str == NULL)
-		exit_with_error ();
-	while (true) {
-		validate_user_buffer (str, 1, false);
-		if (*str == '\0') break;
-		str++;
+/* Copies the null-terminated user string USRC into DST, which has
+   room for SIZE bytes including the terminator.  Returns the length
+   of the string, or -1 if USRC is invalid or does not fit. */
+int64_t
+strncpy_from_user (char *dst, const char *usrc, size_t size) {
+	const uint8_t *src = (const uint8_t *) usrc;
+	for (size_t i = 0; i < size; i++) {
+		if (!is_user_vaddr (src + i)) return -1;
+		int64_t byte = get_user (src + i);
+		if (byte == -1) return -1;
+		dst[i] = byte;
+		if (byte == '\0') return i;
 	}
+	return -1;
 }
 
 static char *
 copy_user_string (const char *str) {
-	validate_user_string (str);
 	char *copy = palloc_get_page (0);
 	if (copy == NULL) return NULL;
-	strlcpy (copy, str, PGSIZE);
+	if (strncpy_from_user (copy, str, PGSIZE) < 0) {
+		/* Unreadable, or too long for the page.  A long string is
+		   truncated, as strlcpy() would, once the rest of it has
+		   been found readable up to its terminator. */
+		for (const char *p = str; ; p++) {
+			int64_t byte = is_user_vaddr (p) ? get_user ((const uint8_t *) p) : -1;
+			if (byte == -1) {
+				palloc_free_page (copy);
+				exit_with_error ();
+			}
+			if (byte == '\0')
+				break;
+		}
+		copy[PGSIZE - 1] = '\0';
+	}
 	return copy;
 }
 
@@ -308,9 +909,7 @@ create_handler (const char *file, unsigned initial_size) {
 	// printf("🔥 entered create_handler\n");
 	char *file_copy = copy_user_string (file);
 	if (file_copy == NULL) return false;
-	lock_acquire (&filesys_lock);
 	bool success = filesys_create (file_copy, initial_size);
-	lock_release (&filesys_lock);
 	palloc_free_page (file_copy);
 	return success;
 }
@@ -320,9 +919,7 @@ remove_handler (const char *file) {
 	char *file_copy = copy_user_string (file);
 	if (file_copy == NULL)
 		return false;
-	lock_acquire (&filesys_lock);
 	bool success = filesys_remove (file_copy);
-	lock_release (&filesys_lock);
 	palloc_free_page (file_copy);
 	return success;
 }
@@ -332,18 +929,14 @@ open_handler (const char *file) {
 	char *file_copy = copy_user_string (file);
 	if (file_copy == NULL) return -1;
 
-	lock_acquire (&filesys_lock);
 	struct file *opened = filesys_open (file_copy);
-	lock_release (&filesys_lock);
 	palloc_free_page (file_copy);
 
 	if (opened == NULL) return -1;
 
 	int fd = allocate_fd (opened);
 	if (fd == -1) {
-		lock_acquire (&filesys_lock);
 		file_close (opened);
-		lock_release (&filesys_lock);
 	}
 	return fd;
 }
@@ -351,10 +944,8 @@ open_handler (const char *file) {
 static int
 filesize_handler (int fd) {
 	struct file_descriptor *desc = fd_lookup (fd);
-	if (desc == NULL) return -1;
-	lock_acquire (&filesys_lock);
+	if (desc == NULL || desc->file == NULL) return -1;
 	int size = file_length (desc->file);
-	lock_release (&filesys_lock);
 	return size;
 }
 
@@ -362,38 +953,117 @@ static void
 seek_handler (int fd, unsigned position) {
 	struct file_descriptor *desc = fd_lookup (fd);
 	if (!desc || !desc->file) return;
-	lock_acquire (&filesys_lock);
 	file_seek (desc->file, position);
-	lock_release (&filesys_lock);
 }
 
 static unsigned
 tell_handler (int fd) {
 	struct file_descriptor *desc = fd_lookup (fd);
-	if (desc == NULL)
+	if (desc == NULL || desc->file == NULL)
 		return 0;
-	lock_acquire (&filesys_lock);
 	off_t pos = file_tell (desc->file);
-	lock_release (&filesys_lock);
 	return (unsigned) pos;
 }
 
 static void
 close_handler (int fd) {
-	struct file_descriptor *desc = fd_lookup (fd);
-	if (desc == NULL) return;
-	close_fd (desc);
+	if (fd_lookup (fd) == NULL) return;
+	close_fd (thread_current (), fd);
+}
+
+/* edward: descriptor table helpers.
+   T->fd_table is indexed directly by fd and T->fd_map keeps one bit
+   per slot, so lookup is a bounds check plus a bit test and the
+   lowest free descriptor is found a 64-bit word at a time. */
+
+#define FD_WORD_BITS 64
+#define FD_WORDS(CAP) (((CAP) + FD_WORD_BITS - 1) / FD_WORD_BITS)
+
+static inline bool
+fd_in_use (const struct thread *t, int fd) {
+	return t->fd_map[fd / FD_WORD_BITS] & (1ULL << (fd % FD_WORD_BITS));
+}
+
+static inline void
+fd_mark (struct thread *t, int fd, bool used) {
+	if (used) t->fd_map[fd / FD_WORD_BITS] |= 1ULL << (fd % FD_WORD_BITS);
+	else t->fd_map[fd / FD_WORD_BITS] &= ~(1ULL << (fd % FD_WORD_BITS));
+}
+
+/* Grows T's descriptor table so that it has at least CAP slots.
+   Capacity doubles so that a run of opens costs amortized O(1). */
+static bool
+fd_table_reserve (struct thread *t, size_t cap) {
+	if (cap <= t->fd_cap) return true;
+	if (cap > FD_MAX) return false;
+
+	size_t new_cap = t->fd_cap ? t->fd_cap : FD_INIT_CAP;
+	while (new_cap < cap) new_cap *= 2;
+	if (new_cap > FD_MAX) new_cap = FD_MAX;
+
+	struct file_descriptor *table = calloc (new_cap, sizeof *table);
+	uint64_t *map = calloc (FD_WORDS (new_cap), sizeof *map);
+	if (table == NULL || map == NULL) {
+		free (table);
+		free (map);
+		return false;
+	}
+	if (t->fd_cap) {
+		memcpy (table, t->fd_table, t->fd_cap * sizeof *table);
+		memcpy (map, t->fd_map, FD_WORDS (t->fd_cap) * sizeof *map);
+	}
+	free (t->fd_table);
+	free (t->fd_map);
+	t->fd_table = table;
+	t->fd_map = map;
+	t->fd_cap = new_cap;
+	return true;
+}
+
+/* Puts FILE (of kind KIND) into slot FD of T's table, growing the
+   table if needed.  Slot FD must be free. */
+static bool
+fd_install (struct thread *t, int fd, struct file *file, enum fd_kind kind) {
+	if (!fd_table_reserve (t, (size_t) fd + 1)) return false;
+	ASSERT (!fd_in_use (t, fd));
+	t->fd_table[fd].file = file;
+	t->fd_table[fd].pipe = NULL;
+	t->fd_table[fd].fd_kind = kind;
+	fd_mark (t, fd, true);
+	return true;
+}
+
+/* Returns the lowest free descriptor of T, or -1 if the table is
+   full. */
+static int
+fd_lowest_free (struct thread *t) {
+	for (size_t w = 0; w < FD_WORDS (t->fd_cap); w++) {
+		if (~t->fd_map[w] == 0) continue;
+		int fd = w * FD_WORD_BITS + __builtin_ctzll (~t->fd_map[w]);
+		if ((size_t) fd < t->fd_cap) return fd;
+	}
+	return t->fd_cap < FD_MAX ? (int) t->fd_cap : -1;
+}
+
+/* Sets up T's descriptor table with stdin and stdout. */
+bool
+fd_table_init (struct thread *t) {
+	t->fd_table = NULL;
+	t->fd_map = NULL;
+	t->fd_cap = 0;
+	if (!fd_table_reserve (t, FD_INIT_CAP)) return false;
+	fd_install (t, 0, NULL, FD_STDIN);
+	fd_install (t, 1, NULL, FD_STDOUT);
+	t->fds_initialized = true;
+	return true;
 }
 
 static struct file_descriptor *
 fd_lookup (int fd) {
 	struct thread *curr = thread_current ();
 	if (!curr->fds_initialized) return NULL;
-	for (struct list_elem *e = list_begin (&curr->file_descriptors); e != list_end (&curr->file_descriptors); e = list_next (e)) {
-		struct file_descriptor *desc = list_entry (e, struct file_descriptor, elem);
-		if (desc->fd == fd) return desc;
-	}
-	return NULL;
+	if (fd < 0 || (size_t) fd >= curr->fd_cap || !fd_in_use (curr, fd)) return NULL;
+	return &curr->fd_table[fd];
 }
 
 static int
@@ -401,49 +1071,57 @@ allocate_fd (struct file *file) {
 	struct thread *curr = thread_current ();
 	if (!curr->fds_initialized) return -1;
 
-	struct file_descriptor *desc = malloc (sizeof *desc);
-	if (desc == NULL) return -1;
-	desc->fd = curr->next_fd++;
-	desc->file = file;
-	desc->fd_kind = FD_FILE;
-	list_push_back (&curr->file_descriptors, &desc->elem);
-	return desc->fd;
+	int fd = fd_lowest_free (curr);
+	if (fd < 0 || !fd_install (curr, fd, file, FD_FILE)) return -1;
+	return fd;
+}
+
+/* Installs one end of PIPE, of kind KIND, at the lowest free
+   descriptor.  Takes over the caller's reference to that end. */
+static int
+allocate_pipe_fd (struct pipe *pipe, enum fd_kind kind) {
+	struct thread *curr = thread_current ();
+	if (!curr->fds_initialized) return -1;
+
+	int fd = fd_lowest_free (curr);
+	if (fd < 0 || !fd_install (curr, fd, NULL, kind)) return -1;
+	curr->fd_table[fd].pipe = pipe;
+	return fd;
 }
 
 static void
-close_fd (struct file_descriptor *desc) {
-	list_remove (&desc->elem);
+close_fd (struct thread *t, int fd) {
+	struct file_descriptor *desc = &t->fd_table[fd];
+	fd_mark (t, fd, false);
 	if (desc->fd_kind == FD_FILE && desc->file != NULL && --desc->file->ref_cnt == 0) {
-		lock_acquire (&filesys_lock);
 		file_close (desc->file);
-		lock_release (&filesys_lock);
 	}
-	else if(desc->fd_kind == FD_STDIN && !desc->file) thread_current()->stdin_cnt--;
-	else if(desc->fd_kind == FD_STDOUT && !desc->file) thread_current()->stdout_cnt--;
-	free (desc);
+	else if (FD_IS_PIPE (desc->fd_kind)) pipe_close_end (desc->pipe, desc->fd_kind == FD_PIPE_WRITE);
+	else if(desc->fd_kind == FD_STDIN && !desc->file) t->stdin_cnt--;
+	else if(desc->fd_kind == FD_STDOUT && !desc->file) t->stdout_cnt--;
+	desc->file = NULL;
+	desc->pipe = NULL;
 }
 
 static void
 close_all_files (struct thread *t) {
 	if (t == NULL || !t->fds_initialized) return;
-	while (!list_empty (&t->file_descriptors)) {
-		struct file_descriptor *desc = list_entry (list_begin (&t->file_descriptors), struct file_descriptor, elem);
-		close_fd (desc);
-	}
-	t->next_fd = 0;
+	for (size_t w = 0; w < FD_WORDS (t->fd_cap); w++)
+		while (t->fd_map[w] != 0)
+			close_fd (t, w * FD_WORD_BITS + __builtin_ctzll (t->fd_map[w]));
 }
 
 void
 syscall_process_cleanup (void) {
-	close_all_files (thread_current ());
-}
-
-void
-update_fduplicated(struct thread *thread, bool b_value) {
-	for (struct list_elem *e = list_begin (&thread->file_descriptors); e != list_end (&thread->file_descriptors); e = list_next (e)) {
-		struct file_descriptor *desc = list_entry (e, struct file_descriptor, elem);
-		if(desc->file) desc->file->is_duplicated = b_value;
-	}
+	struct thread *curr = thread_current ();
+	if (!curr->fds_initialized) return;
+	close_all_files (curr);
+	free (curr->fd_table);
+	free (curr->fd_map);
+	curr->fd_table = NULL;
+	curr->fd_map = NULL;
+	curr->fd_cap = 0;
+	curr->fds_initialized = false;
 }
 
 bool
@@ -454,88 +1132,77 @@ syscall_duplicate_fds (struct thread *parent, struct thread *child) {
 	if (!parent->fds_initialized)
 		return true;
 	if (!child->fds_initialized) {
-		list_init (&child->file_descriptors);
-		// child->next_fd = 2;
+		child->fd_table = NULL;
+		child->fd_map = NULL;
+		child->fd_cap = 0;
 		child->fds_initialized = true;
 	}
 	else close_all_files(child);
 
-	update_fduplicated(parent, false);
-	for (struct list_elem *e = list_begin (&parent->file_descriptors); e != list_end (&parent->file_descriptors); e = list_next (e)) {
-		/* edward: allocate child file descriptor */
-		struct file_descriptor *parent_fd = list_entry (e, struct file_descriptor, elem);
-		struct file_descriptor *child_fd = malloc (sizeof *child_fd);
-		if (child_fd == NULL) {
-			close_all_files (child);
-			return false;
-		}
+	/* edward: the table itself is copied in bulk; only the open files
+	   need per-slot work afterwards. */
+	if (!fd_table_reserve (child, parent->fd_cap)) return false;
+	memcpy (child->fd_table, parent->fd_table, parent->fd_cap * sizeof *child->fd_table);
+	memcpy (child->fd_map, parent->fd_map, FD_WORDS (parent->fd_cap) * sizeof *child->fd_map);
 
-		/* edward
-		CASE 00: not a file (stdin/stdout)
-		CASE 01: not duplicated > duplicate a file from parent
-		CASE 02: already duplicated > find duplicated file with inode address
-		*/
-		struct file *duplicated_file = NULL;
-		if(!parent_fd->file) duplicated_file = parent_fd->file;
-		else if (!parent_fd->file->is_duplicated) {
-			lock_acquire (&filesys_lock);
-			duplicated_file = file_duplicate (parent_fd->file);
-			lock_release (&filesys_lock);
-			if (duplicated_file == NULL) {
-				free (child_fd);
-				close_all_files (child);
-				return false;
-			}
-			parent_fd->file->is_duplicated = true;
+	/* edward
+	Descriptors that share one struct file in the parent (dup2) must
+	share one struct file in the child too.  The first slot that sees a
+	parent file duplicates it and parks the copy in fork_copy; later
+	slots just take another reference.
+	*/
+	bool success = true;
+	size_t fd;
+	for (fd = 0; fd < parent->fd_cap; fd++) {
+		if (!fd_in_use (parent, fd)) continue;
+		enum fd_kind kind = parent->fd_table[fd].fd_kind;
+		if (FD_IS_PIPE (kind)) {
+			pipe_open_end (parent->fd_table[fd].pipe, kind == FD_PIPE_WRITE);
+			continue;
 		}
-		else {
-			struct inode *identifier = parent_fd->file->inode;
-			for (struct list_elem *t = list_begin (&child->file_descriptors); t != list_end (&child->file_descriptors); t = list_next (t)) {
-				struct file_descriptor *desc = list_entry (t, struct file_descriptor, elem);
-				if (!desc->file) continue;
-				if (desc->file->inode == identifier) {
-					duplicated_file = desc->file;
-					if (duplicated_file) duplicated_file->ref_cnt++;
-					break;
-				}
-			}
-			if (duplicated_file == NULL) {
-				lock_acquire (&filesys_lock);
-				duplicated_file = file_duplicate (parent_fd->file);
-				lock_release (&filesys_lock);
-				if (duplicated_file == NULL) {
-					free (child_fd);
-					close_all_files (child);
-					return false;
-				}
+		struct file *parent_file = parent->fd_table[fd].file;
+		if (parent->fd_table[fd].fd_kind != FD_FILE || parent_file == NULL) continue;
+
+		if (parent_file->fork_copy == NULL) {
+			parent_file->fork_copy = file_duplicate (parent_file);
+			if (parent_file->fork_copy == NULL) {
+				success = false;
+				break;
 			}
 		}
+		else parent_file->fork_copy->ref_cnt++;
+		child->fd_table[fd].file = parent_file->fork_copy;
+	}
 
-		child_fd->file = duplicated_file; /* edward: link file to the descriptor */
-		child_fd->fd = parent_fd->fd; /* edward: copy the descriptor number */
-		child_fd->fd_kind = parent_fd->fd_kind;
-		list_push_back (&child->file_descriptors, &child_fd->elem); /* edward: enlist the descriptor */
+	if (!success) {
+		/* edward: slots from FD on still point at the parent's files. */
+		for (; fd < parent->fd_cap; fd++)
+			if (fd_in_use (child, fd)) fd_mark (child, fd, false);
 	}
-	child->next_fd = parent->next_fd;
-	return true;
+	for (size_t i = 0; i < parent->fd_cap; i++)
+		if (fd_in_use (parent, i) && parent->fd_table[i].file != NULL)
+			parent->fd_table[i].file->fork_copy = NULL;
+	if (!success) close_all_files (child);
+	return success;
 }
 
 int
 dup2_handler (int oldfd, int newfd) {
+	struct thread *curr = thread_current ();
 	struct file_descriptor *desc_old = fd_lookup(oldfd);
 	if(!desc_old) return -1;
 	if(oldfd == newfd) return newfd;
-	
-	struct file_descriptor *desc_new = fd_lookup(newfd);
-	if(desc_new) close_fd(desc_new);
-	desc_new = malloc(sizeof(*desc_new));
-	if(!desc_new) return -1;
-	desc_new->fd = newfd;
-	desc_new->fd_kind = desc_old->fd_kind;
-	desc_new->file = desc_old->file;
-	if (desc_new->fd_kind == FD_FILE && desc_new->file) desc_old->file->ref_cnt++;
-	else if(desc_new->fd_kind == FD_STDIN && !desc_new->file) thread_current()->stdin_cnt++;
-	else if(desc_new->fd_kind == FD_STDOUT && !desc_new->file) thread_current()->stdout_cnt++;
-	list_push_back (&thread_current ()->file_descriptors, &desc_new->elem);
+	if(newfd < 0 || newfd >= FD_MAX) return -1;
+
+	struct file *file = desc_old->file;
+	struct pipe *pipe = desc_old->pipe;
+	enum fd_kind kind = desc_old->fd_kind;
+	if(fd_lookup(newfd)) close_fd(curr, newfd);
+	if(!fd_install(curr, newfd, file, kind)) return -1;
+	curr->fd_table[newfd].pipe = pipe;
+	if (kind == FD_FILE && file) file->ref_cnt++;
+	else if (FD_IS_PIPE (kind)) pipe_open_end (pipe, kind == FD_PIPE_WRITE);
+	else if(kind == FD_STDIN && !file) curr->stdin_cnt++;
+	else if(kind == FD_STDOUT && !file) curr->stdout_cnt++;
 	return newfd;
 }
@@ -5,8 +5,12 @@
 #include "lib/kernel/bitmap.h"
 #include "threads/synch.h"
 
+#include <list.h>
+#include <round.h>
 #include <string.h>
 #include "bitmap.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
 #include "threads/vaddr.h"
 
 /* DO NOT MODIFY BELOW LINE */
@@ -20,6 +24,27 @@ static void anon_destroy (struct page *page);
 /*swap table*/
 static struct bitmap *swap_table;
 
+static bool anon_shared_swap_in (struct page *page, void *kva);
+static void anon_shared_destroy (struct page *page);
+
+/* A shared anonymous segment.
+ * Every process that maps the segment gets its own struct page per
+ * segment page, but all of them map the one frame in FRAMES.  Frames
+ * belong to the segment, not to any page table: a shared page clears
+ * its PTE before going away so that pml4_destroy() leaves the frame
+ * alone, and the frames are freed with the last reference. */
+struct shm_segment {
+  char name[SHM_NAME_MAX + 1];  /* Empty for anonymous segments. */
+  size_t page_cnt;              /* Size in pages. */
+  struct frame **frames;        /* One per page, NULL until touched. */
+  int ref_cnt;                  /* Mapped pages, +1 while named. */
+  struct list_elem elem;        /* In named_segments if named. */
+};
+
+/* Named segments, and the lock that guards it and every segment. */
+static struct list named_segments;
+static struct lock shm_lock;
+
 /* DO NOT MODIFY this struct */
 static const struct page_operations anon_ops = {
   .swap_in = anon_swap_in,
@@ -28,6 +53,13 @@ static const struct page_operations anon_ops = {
   .type = VM_ANON,
 };
 
+static const struct page_operations anon_shared_ops = {
+  .swap_in = anon_shared_swap_in,
+  .swap_out = NULL,
+  .destroy = anon_shared_destroy,
+  .type = VM_ANON | VM_SHARED,
+};
+
 /* Initialize the data for anonymous pages */
 void
 vm_anon_init (void) {
@@ -39,6 +71,9 @@ vm_anon_init (void) {
   ASSERT (swap_bitmap != NULL);
 
   lock_init(&swap_lock);
+
+  list_init(&named_segments);
+  lock_init(&shm_lock);
 }
 
 /* Initialize the file mapping */
@@ -48,6 +83,7 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
   page->operations = &anon_ops;
   struct anon_page *anon_page = &page->anon;
   anon_page->slot_idx = BITMAP_ERROR; /* BITMAP_ERROR: both for unallocated and error */
+  anon_page->shm = NULL;
   
   return true;
 }
@@ -56,6 +92,13 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 static bool
 anon_swap_in (struct page *page, void *kva) {
   struct anon_page *anon_page = &page->anon;
+
+  /* edward: not in swap, i.e. dropped by MADV_DONTNEED: comes back as zeros */
+  if (anon_page->slot_idx == BITMAP_ERROR) {
+    memset(kva, 0, PGSIZE);
+    return true;
+  }
+  return false;
 }
 
 /* Swap out the page by writing contents to the swap disk. */
@@ -76,3 +119,242 @@ anon_destroy (struct page *page) {
     //     page->frame = NULL;
     // }
 }
+
+/* Returns the named segment called NAME, or NULL.
+ * The caller must hold shm_lock. */
+static struct shm_segment *
+shm_lookup (const char *name) {
+  struct list_elem *e;
+
+  for (e = list_begin(&named_segments); e != list_end(&named_segments); e = list_next(e)) {
+    struct shm_segment *seg = list_entry(e, struct shm_segment, elem);
+    if (!strcmp(seg->name, name)) {
+      return seg;
+    }
+  }
+  return NULL;
+}
+
+/* Creates a segment of PAGE_CNT pages, registered under NAME if NAME
+ * is not NULL.  The caller must hold shm_lock. */
+static struct shm_segment *
+shm_create (const char *name, size_t page_cnt) {
+  struct shm_segment *seg = malloc(sizeof *seg);
+  if (!seg) {
+    return NULL;
+  }
+  seg->frames = calloc(page_cnt, sizeof *seg->frames);
+  if (!seg->frames) {
+    free(seg);
+    return NULL;
+  }
+  seg->page_cnt = page_cnt;
+  seg->ref_cnt = 0;
+  seg->name[0] = '\0';
+  if (name) {
+    strlcpy(seg->name, name, sizeof seg->name);
+    list_push_back(&named_segments, &seg->elem);
+    seg->ref_cnt++;
+  }
+  return seg;
+}
+
+/* Drops a reference to SEG, freeing it and its frames with the last. */
+static void
+shm_put (struct shm_segment *seg) {
+  lock_acquire(&shm_lock);
+  bool dead = --seg->ref_cnt == 0;
+  lock_release(&shm_lock);
+  if (!dead) {
+    return;
+  }
+
+  for (size_t i = 0; i < seg->page_cnt; i++) {
+    if (seg->frames[i]) {
+      vm_free_frame(seg->frames[i]);
+    }
+  }
+  free(seg->frames);
+  free(seg);
+}
+
+/* Adds a page for index IDX of SEG at VA to the current process. */
+static bool
+shm_add_page (void *va, struct shm_segment *seg, size_t idx) {
+  struct page *page = malloc(sizeof *page);
+  if (!page) {
+    return false;
+  }
+  *page = (struct page) {
+    .operations = &anon_shared_ops,
+    .va = va,
+    .frame = NULL,
+    .writable = true,
+  };
+  page->anon.slot_idx = BITMAP_ERROR;
+  page->anon.shm = seg;
+  page->anon.shm_idx = idx;
+
+  if (!spt_insert_page(&thread_current()->spt, page)) {
+    free(page);
+    return false;
+  }
+  lock_acquire(&shm_lock);
+  seg->ref_cnt++;
+  lock_release(&shm_lock);
+  return true;
+}
+
+/* Maps LENGTH bytes of shared memory at ADDR in the current process.
+ * If NAME is NULL the segment is new and anonymous, and is shared only
+ * with children forked later.  Otherwise the segment called NAME is
+ * attached, being created first if it does not exist; an existing
+ * segment must be at least LENGTH bytes long.  Pages are zero-filled
+ * and allocated on first touch.  Returns ADDR, or NULL on failure. */
+void *
+anon_shared_map (void *addr, size_t length, const char *name) {
+  struct supplemental_page_table *spt = &thread_current()->spt;
+  size_t page_cnt = DIV_ROUND_UP(length, PGSIZE);
+  uint8_t *upage = addr;
+
+  if (!addr || pg_ofs(addr) || !length || length > USER_STACK) {
+    return NULL;
+  }
+  if (name && (!*name || strlen(name) > SHM_NAME_MAX)) {
+    return NULL;
+  }
+  if (!is_user_vaddr(upage + page_cnt * PGSIZE - 1) || upage + page_cnt * PGSIZE < upage) {
+    return NULL;
+  }
+  for (size_t i = 0; i < page_cnt; i++) {
+    if (spt_find_page(spt, upage + i * PGSIZE)) {
+      return NULL;
+    }
+  }
+
+  /* edward: hold a reference of our own while the pages go in */
+  lock_acquire(&shm_lock);
+  struct shm_segment *seg = name ? shm_lookup(name) : NULL;
+  if (!seg) {
+    seg = shm_create(name, page_cnt);
+  } else if (seg->page_cnt < page_cnt) {
+    seg = NULL;
+  }
+  if (seg) {
+    seg->ref_cnt++;
+  }
+  lock_release(&shm_lock);
+  if (!seg) {
+    return NULL;
+  }
+
+  size_t i;
+  for (i = 0; i < page_cnt; i++) {
+    if (!shm_add_page(upage + i * PGSIZE, seg, i)) {
+      break;
+    }
+  }
+  if (i < page_cnt && i > 0) {
+    anon_shared_unmap(addr);
+  }
+  shm_put(seg);
+  return i == page_cnt ? addr : NULL;
+}
+
+/* Unmaps the shared mapping that starts at ADDR.  Returns false if no
+ * mapping starts there. */
+bool
+anon_shared_unmap (void *addr) {
+  struct supplemental_page_table *spt = &thread_current()->spt;
+  struct page *page = spt_find_page(spt, addr);
+
+  if (pg_ofs(addr) || !page || page->operations != &anon_shared_ops || page->anon.shm_idx != 0) {
+    return false;
+  }
+
+  struct shm_segment *seg = page->anon.shm;
+  for (size_t i = 0; page && page->operations == &anon_shared_ops
+       && page->anon.shm == seg && page->anon.shm_idx == i; i++) {
+    struct page *next = spt_find_page(spt, (uint8_t *) addr + (i + 1) * PGSIZE);
+    spt_remove_page(spt, page);
+    page = next;
+  }
+  return true;
+}
+
+/* Removes NAME from the namespace.  Processes that have the segment
+ * mapped keep it until they unmap it.  Returns false if there is no
+ * segment called NAME. */
+bool
+anon_shared_unlink (const char *name) {
+  lock_acquire(&shm_lock);
+  struct shm_segment *seg = shm_lookup(name);
+  if (seg) {
+    list_remove(&seg->elem);
+    seg->name[0] = '\0';
+  }
+  lock_release(&shm_lock);
+
+  if (!seg) {
+    return false;
+  }
+  shm_put(seg);
+  return true;
+}
+
+/* Maps the segment page behind SRC at the same address in the current
+ * process, for fork. */
+bool
+anon_shared_copy (struct page *src) {
+  return shm_add_page(src->va, src->anon.shm, src->anon.shm_idx);
+}
+
+/* Returns the segment's frame for shared PAGE, allocating and zeroing
+ * it on first touch, or NULL if PAGE is not shared. */
+struct frame *
+anon_shared_frame (struct page *page) {
+  if (page->operations != &anon_shared_ops) {
+    return NULL;
+  }
+
+  struct shm_segment *seg = page->anon.shm;
+  lock_acquire(&shm_lock);
+  struct frame **slot = &seg->frames[page->anon.shm_idx];
+  if (!*slot) {
+    *slot = vm_get_frame();
+    memset((*slot)->kva, 0, PGSIZE);
+  }
+  struct frame *frame = *slot;
+  lock_release(&shm_lock);
+  return frame;
+}
+
+/* Returns the segment behind shared PAGE and stores the page's index
+ * in it in *IDX, or returns NULL if PAGE is not shared. */
+struct shm_segment *
+anon_shared_segment (struct page *page, size_t *idx) {
+  if (page->operations != &anon_shared_ops) {
+    return NULL;
+  }
+  *idx = page->anon.shm_idx;
+  return page->anon.shm;
+}
+
+/* The segment's frame already holds the data. */
+static bool
+anon_shared_swap_in (struct page *page UNUSED, void *kva UNUSED) {
+  return true;
+}
+
+/* Detaches shared PAGE from its segment. PAGE will be freed by the
+ * caller. */
+static void
+anon_shared_destroy (struct page *page) {
+  uint64_t *pml4 = thread_current()->pml4;
+
+  /* edward: the frame is the segment's; keep pml4_destroy() off it */
+  if (page->frame && pml4) {
+    pml4_clear_page(pml4, page->va);
+  }
+  shm_put(page->anon.shm);
+}
@@ -117,11 +117,12 @@ spt_insert_page (struct supplemental_page_table *spt, struct page *page) {
 }
 
 void spt_remove_page(struct supplemental_page_table *spt, struct page *page) {
+  hash_delete(&spt->h_table, &page->hash_elem);
   vm_dealloc_page(page);
-  return true; /* edward: void??? true??? */
 }
 
-/* Get the struct frame, that will be evicted. */
+/* Get the struct frame, that will be evicted.  Frames of shared
+ * segments have no page (frame->page == NULL) and are never victims. */
 static struct frame *vm_get_victim(void) {
   struct frame *victim = NULL;
   /* TODO: The policy for eviction is up to you. */
@@ -142,7 +143,7 @@ static struct frame *vm_evict_frame(void) {
  * and return it. This always return valid address. That is, if the user pool
  * memory is full, this function evicts the frame to get the available memory
  * space.*/
-static struct frame *
+struct frame *
 vm_get_frame (void) {
   struct frame *frame = malloc(sizeof(struct frame));      
   ASSERT (frame != NULL);
@@ -164,6 +165,139 @@ vm_get_frame (void) {
   return frame;
 }
 
+/* Releases FRAME and its memory.  Only for frames that are not left
+ * for pml4_destroy() to free, i.e. frames of shared segments. */
+void
+vm_free_frame (struct frame *frame) {
+  lock_acquire(&frame_lock);
+  list_remove(&frame->frame_elem);
+  lock_release(&frame_lock);
+
+  palloc_free_page(frame->kva);
+  free(frame);
+}
+
+/* Fills a fresh heap page with zeros. */
+static bool
+zero_page_init (struct page *page, void *aux UNUSED) {
+  memset(page->frame->kva, 0, PGSIZE);
+  return true;
+}
+
+/* Returns true if PAGE is a private anonymous page that started out as
+ * zeros, i.e. a heap or stack page.  Pages of loaded segments are
+ * VM_ANON too, but their contents came from the executable. */
+static bool
+vm_is_zero_fill (struct page *page) {
+  struct thread *curr = thread_current();
+  uint8_t *va = page->va;
+
+  if (page->operations->type != VM_ANON) {
+    return false;
+  }
+  if (va >= (uint8_t *) curr->heap_start && va < (uint8_t *) pg_round_up(curr->brk)) {
+    return true;
+  }
+  return va >= (uint8_t *) USER_STACK - STACK_LIMIT && va < (uint8_t *) USER_STACK;
+}
+
+/* Gives back the frame behind PAGE, if any, so that the next access
+ * faults it in again as zeros.  Only heap and stack pages can do this;
+ * returns false for any other page that has a frame. */
+static bool
+vm_drop_frame (struct page *page) {
+  if (!page->frame) {
+    return true;
+  }
+  if (!vm_is_zero_fill(page)) {
+    return false;
+  }
+  pml4_clear_page(thread_current()->pml4, page->va);
+  vm_free_frame(page->frame);
+  page->frame = NULL;
+  return true;
+}
+
+/* Moves the current process's program break by INCREMENT bytes and
+ * returns the old break, or (void *) -1 on failure.  Pages that come
+ * into the heap are lazy, zero-filled VM_ANON pages; pages that leave
+ * it are dropped from the SPT together with their frames. */
+void *
+vm_sbrk (intptr_t increment) {
+  struct thread *curr = thread_current();
+  struct supplemental_page_table *spt = &curr->spt;
+  uint8_t *old_brk = curr->brk;
+  uint8_t *new_brk = old_brk + increment;
+  uint8_t *p;
+
+  if (!old_brk) {
+    return (void *) -1;
+  }
+  if (increment < 0 ? (new_brk > old_brk || new_brk < (uint8_t *) curr->heap_start)
+                    : (new_brk < old_brk || new_brk > (uint8_t *) USER_STACK - STACK_LIMIT)) {
+    return (void *) -1;
+  }
+
+  if (increment > 0) {
+    for (p = pg_round_up(old_brk); p < new_brk; p += PGSIZE) {
+      if (spt_find_page(spt, p)) {
+        return (void *) -1;
+      }
+    }
+    for (p = pg_round_up(old_brk); p < new_brk; p += PGSIZE) {
+      if (!vm_alloc_page_with_initializer(VM_ANON, p, true, zero_page_init, NULL)) {
+        /* edward: undo the pages added so far */
+        while ((p -= PGSIZE) >= (uint8_t *) pg_round_up(old_brk)) {
+          spt_remove_page(spt, spt_find_page(spt, p));
+        }
+        return (void *) -1;
+      }
+    }
+  } else {
+    for (p = pg_round_up(new_brk); p < (uint8_t *) pg_round_up(old_brk); p += PGSIZE) {
+      struct page *page = spt_find_page(spt, p);
+      if (page) {
+        vm_drop_frame(page);
+        spt_remove_page(spt, page);
+      }
+    }
+  }
+
+  curr->brk = new_brk;
+  return old_brk;
+}
+
+/* Applies ADVICE to the pages in [ADDR, ADDR + LENGTH).  For
+ * MADV_DONTNEED the frames of heap and stack pages are freed and the
+ * pages read back as zeros; other pages in the range, including the
+ * executable's data, are left alone.
+ * Returns false if ADDR is not page-aligned, the range is not user
+ * memory, or ADVICE is unknown. */
+bool
+vm_madvise (void *addr, size_t length, int advice) {
+  struct supplemental_page_table *spt = &thread_current()->spt;
+  uint8_t *start = addr;
+  uint8_t *end = start + length;
+
+  if (pg_ofs(addr) || end < start || (length && !is_user_vaddr(end - 1))) {
+    return false;
+  }
+  switch (advice) {
+    case MADV_NORMAL:
+      return true;
+    case MADV_DONTNEED:
+      for (uint8_t *p = start; p < end; p += PGSIZE) {
+        struct page *page = spt_find_page(spt, p);
+        if (page) {
+          vm_drop_frame(page);
+        }
+      }
+      return true;
+    default:
+      return false;
+  }
+}
+
 /* Growing the stack. */
 static void vm_stack_growth(void *addr) {
   void *stack_bottom = pg_round_down(addr);
@@ -235,13 +369,22 @@ vm_claim_page (void *va) {
 /* Claim the PAGE and set up the mmu. */
 static bool
 vm_do_claim_page (struct page *page) {
-  struct frame *frame = vm_get_frame ();
-  frame->page = page;
+  /* edward: shared pages map the segment's frame instead of a fresh one.
+   * That frame is the segment's, not any one sharer's, so it gets no
+   * back-pointer: frame->page stays NULL and eviction must pass it by. */
+  struct frame *frame = anon_shared_frame (page);
+  bool shared = frame != NULL;
+  if (!shared) {
+    frame = vm_get_frame ();
+    frame->page = page;
+  }
   page->frame = frame;
   
   if (!pml4_set_page(thread_current()->pml4, page->va, frame->kva, page->writable)) {
     page->frame = NULL;
-    frame->page = NULL;
+    if (!shared) {
+      frame->page = NULL;
+    }
     return false;
   }
   return swap_in (page, frame->kva); /* swap the data into the frame that we got previously */
@@ -271,6 +414,14 @@ bool supplemental_page_table_copy(struct supplemental_page_table *dst , struct s
       return false;
     }
     
+    /* edward: shared pages are mapped again, not copied */
+    if (src_page->operations->type & VM_SHARED) {
+      if (!anon_shared_copy(src_page)) {
+        return false;
+      }
+      continue;
+    }
+
     /*VM_TYPE to switch*/
     switch (VM_TYPE(src_page->operations->type)) {
         case VM_UNINIT:
@@ -333,7 +484,7 @@ static bool __copy_uninit(struct page *src_page) {
     memcpy(aux_copy, src_uninit->aux, sizeof(struct lazy_load_aux));
   }
 
-  if (intended_type == VM_ANON){
+  if (intended_type == VM_ANON && aux_copy){
     aux_copy->file = thread_current()->running_file;
   }
 
@@ -354,6 +505,11 @@ static bool __copy_init(struct page *src_page) {
   void *va = src_page->va;
   bool writable = src_page->writable;
 
+  /* edward: a page whose frame was dropped comes back as zeros */
+  if (!src_page->frame) {
+    return vm_alloc_page_with_initializer(intended_type, va, writable, zero_page_init, NULL);
+  }
+
   if (!vm_alloc_page_with_initializer(intended_type, va, writable, NULL, NULL)) {
     return false;
   }